@@ -0,0 +1,557 @@
+#include "3D/ray_tracer.hpp"
+#include "3D/triangle_kernel.hpp"
+
+#include <fstream>
+
+using namespace ray_tracer_3d;
+
+
+// Measurement of one benchmark. Every repetition calls the benchmarked code 'iterations' times, each of which processes 'items_per_call' items (rays,
+// triangles or pixels), and records the elapsed seconds. The reported throughput is the median over the repetitions, which is robust against the odd
+// repetition that was disturbed by the rest of the system.
+struct benchmark_result
+{
+    std::string name;
+    std::string group;
+    std::string unit;
+    std::vector<std::pair<std::string, double>> parameters;
+    size_t items_per_call;
+    size_t iterations;
+    std::vector<double> seconds;
+
+
+    inline double median_seconds() const noexcept
+    {
+        std::vector<double> sorted = seconds;
+
+        std::sort(sorted.begin(), sorted.end());
+
+        const size_t middle = sorted.size() / 2;
+
+        return sorted.size() % 2 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2;
+    }
+
+    // Returns the nanoseconds per item of the repetition that took the given number of seconds.
+    inline double nanoseconds_per_item(const double elapsed) const noexcept
+    {
+        return elapsed * 1e9 / (double(items_per_call) * iterations);
+    }
+};
+
+struct benchmark_options
+{
+    // only benchmarks whose name contains this text are run
+    std::string filter;
+    std::string label;
+    double minimum_seconds = .2;
+    size_t repetitions = 5;
+};
+
+// results of the benchmarked code are accumulated here, so that the compiler cannot discard the code as dead
+static volatile size_t sink = 0;
+
+
+template <typename function>
+static void run_benchmark(const benchmark_options& options, std::vector<benchmark_result>* const results, benchmark_result result, const function& call)
+{
+    if (result.name.find(options.filter) == std::string::npos)
+        return;
+
+    using clock = std::chrono::steady_clock;
+
+    const auto seconds_since = [](const clock::time_point start) { return std::chrono::duration<double>(clock::now() - start).count(); };
+
+    std::cerr << result.name << "... " << std::flush;
+
+    // the first call warms up the caches (and builds the acceleration structure of scenes which have not been rendered yet). it also calibrates the
+    // number of calls per repetition.
+    auto start = clock::now();
+
+    sink = sink + call();
+
+    const double first_call = std::max(seconds_since(start), 1e-9);
+
+    result.iterations = size_t(std::max(1., std::ceil(options.minimum_seconds / first_call)));
+
+    for (size_t repetition = 0; repetition < options.repetitions; ++repetition)
+    {
+        size_t accumulated = 0;
+
+        start = clock::now();
+
+        for (size_t i = 0; i < result.iterations; ++i)
+            accumulated += call();
+
+        result.seconds.push_back(seconds_since(start));
+        sink = sink + accumulated;
+    }
+
+    std::cerr << std::fixed << std::setprecision(3) << double(result.items_per_call) * result.iterations / result.median_seconds() / 1e6 << " M"
+              << result.unit << std::defaultfloat << std::endl;
+
+    results->push_back(result);
+}
+
+static benchmark_result make_result(const std::string& name, const std::string& group, const std::string& unit, const size_t items_per_call,
+                                    const std::vector<std::pair<std::string, double>>& parameters = {})
+{
+    benchmark_result result;
+
+    result.name = name;
+    result.group = group;
+    result.unit = unit;
+    result.parameters = parameters;
+    result.items_per_call = items_per_call;
+    result.iterations = 0;
+
+    return result;
+}
+
+static vec3 random_direction(pcg32* const rng) noexcept
+{
+    // rejection sampling of the unit ball, whose points are uniformly distributed over all directions
+    while (true)
+    {
+        const vec3 v(2 * rng->next_float() - 1, 2 * rng->next_float() - 1, 2 * rng->next_float() - 1);
+        const float squared_length = v.squared_length();
+
+        if (squared_length > 1e-4f && squared_length <= 1)
+            return v;
+    }
+}
+
+static vec3 random_point(pcg32* const rng, const float extent) noexcept
+{
+    return vec3(extent * (2 * rng->next_float() - 1), extent * (2 * rng->next_float() - 1), extent * (2 * rng->next_float() - 1));
+}
+
+// Returns rays which start on a sphere of the given radius around the origin and point at random points within [-1, 1]³, so that they hit primitives of
+// about unit size around the origin from all sides, but miss them about as often.
+static std::vector<ray3> make_converging_rays(const size_t count, const float radius, const uint64_t seed)
+{
+    pcg32 rng(seed);
+    std::vector<ray3> rays;
+
+    rays.reserve(count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const vec3 origin = random_direction(&rng).normalize().scale(radius);
+
+        rays.emplace_back(origin, random_point(&rng, 1).sub(origin));
+    }
+
+    return rays;
+}
+
+static render_configuration make_configuration(const size_t width, const size_t height) noexcept
+{
+    render_configuration config = render_configuration();
+
+    // the camera and shading settings of the command line renderer
+    config.horizontal_resolution = width;
+    config.vertical_resolution = height;
+    config.subpixels_per_pixel = 1;
+    config.samples_per_subpixel = 1;
+    config.maximum_iteration_count = 8;
+    config.camera.position = vec3(0, 0, 18);
+    config.camera.look_at = vec3(0, 3, 0);
+    config.camera.zoom_factor = 2;
+    config.camera.focal_length = 1;
+    config.mode = render_mode::realistic_colors;
+    config.background_color = ARGB(0, 0, 0, 0);
+    config.air_refraction_index = 1;
+    config.tile_ordering = tile_order::hilbert_curve;
+
+    return config;
+}
+
+static void run_micro_benchmarks(const benchmark_options& options, std::vector<benchmark_result>* const results)
+{
+    constexpr size_t RAY_COUNT = 4096;
+    const std::vector<ray3> rays = make_converging_rays(RAY_COUNT, 4, 1);
+    const triangle tri(vec3(-1, -1, 0), vec3(1, -1, 0), vec3(0, 1, 0));
+    const sphere ball(vec3::Zero, 1);
+
+    run_benchmark(options, results, make_result("micro/moller_trumbore_intersect", "micro", "rays/s", RAY_COUNT), [&]
+    {
+        size_t hits = 0;
+
+        for (const ray3& ray : rays)
+        {
+            float t, u, v;
+            bool backface = false;
+
+            hits += tri.möller_trumbore_intersect(ray, &t, &u, &v, &backface);
+        }
+
+        return hits;
+    });
+
+    run_benchmark(options, results, make_result("micro/sphere_intersect", "micro", "rays/s", RAY_COUNT), [&]
+    {
+        size_t hits = 0;
+
+        for (const ray3& ray : rays)
+        {
+            hit_test hit = hit_test();
+
+            ball.intersect(ray, &hit);
+            hits += hit.type == hit_test::hit_type::hit;
+        }
+
+        return hits;
+    });
+
+    constexpr size_t RAY_GRID = 64;
+    const render_configuration config = make_configuration(640, 480);
+    const float w = float(config.horizontal_resolution);
+    const float h = float(config.vertical_resolution);
+
+    // primary rays through a grid of points spread over the whole image plane, whose coordinates range from -1 to 1, and jittered within their pixels
+    for (const bool jittered : { false, true })
+    {
+        pcg32 rng(config.seed);
+
+        run_benchmark(options, results, make_result(jittered ? "micro/create_ray_jittered" : "micro/create_ray", "micro", "rays/s", RAY_GRID * RAY_GRID), [&]
+        {
+            float sum = 0;
+
+            for (size_t y = 0; y < RAY_GRID; ++y)
+                for (size_t x = 0; x < RAY_GRID; ++x)
+                    sum += CreateRay3(config, w, h, x * 2.f / RAY_GRID - 1, 1 - y * 2.f / RAY_GRID, jittered ? &rng : nullptr).direction.X;
+
+            return size_t(sum != 0);
+        });
+    }
+}
+
+// Creates a scene of about the given number of triangles. These form a 4x4x4 lattice of bumpy spheres, each tessellated into rings and segments, so that
+// rays pass through empty space between dense clusters of small triangles, as they would in a typical scene.
+static scene* create_triangle_scene(const size_t triangle_count)
+{
+    constexpr int LATTICE = 4;
+    constexpr float SPACING = 3;
+    // a sphere of n rings and 2n segments consists of 4n² triangles
+    const int rings = std::max(2, int(std::lround(std::sqrt(double(triangle_count) / (4 * LATTICE * LATTICE * LATTICE)))));
+    const int segments = 2 * rings;
+    const std::shared_ptr<mesh_arrays> arrays = std::make_shared<mesh_arrays>();
+    scene* const sc = new scene();
+
+    arrays->materials.push_back(material::diffuse(ARGB::WHITE));
+
+    for (int i = 0; i < LATTICE * LATTICE * LATTICE; ++i)
+    {
+        const vec3 center = vec3(float(i % LATTICE), float(i / LATTICE % LATTICE), float(i / (LATTICE * LATTICE))).sub(vec3((LATTICE - 1) / 2.f)).scale(SPACING);
+        const uint first_vertex = uint(arrays->positions.size() / 3);
+
+        for (int ring = 0; ring <= rings; ++ring)
+            for (int segment = 0; segment <= segments; ++segment)
+            {
+                const float theta = ROT_180 * ring / rings;
+                const float phi = 2 * ROT_180 * segment / segments;
+                const float radius = 1 + .1f * std::sin(7 * theta) * std::sin(5 * phi + i);
+
+                arrays->positions.push_back(center.X + radius * std::sin(theta) * std::cos(phi));
+                arrays->positions.push_back(center.Y + radius * std::cos(theta));
+                arrays->positions.push_back(center.Z + radius * std::sin(theta) * std::sin(phi));
+            }
+
+        for (int ring = 0; ring < rings; ++ring)
+            for (int segment = 0; segment < segments; ++segment)
+            {
+                const uint v00 = first_vertex + ring * (segments + 1) + segment;
+                const uint v10 = v00 + segments + 1;
+
+                arrays->indices.insert(arrays->indices.end(), { v00, v10, v00 + 1, v00 + 1, v10, v10 + 1 });
+            }
+    }
+
+    arrays->material_indices.resize(arrays->indices.size() / 3, 0);
+    sc->add_indexed_mesh(mesh_arrays::to_mesh(arrays));
+    sc->add_spot_light(vec3(1, 10, 1), vec3(0, -1, 0), ARGB(1, 1, .7), 100);
+
+    return sc;
+}
+
+static void run_scene_benchmarks(const benchmark_options& options, std::vector<benchmark_result>* const results)
+{
+    constexpr size_t IMAGE_SIZE = 256;
+    constexpr size_t RAY_COUNT = IMAGE_SIZE * IMAGE_SIZE;
+    constexpr float EXTENT = 6;
+
+    for (const auto& [name, triangle_count] : { std::make_pair("1k", 1000), std::make_pair("100k", 100000), std::make_pair("1M", 1000000) })
+    {
+        const std::string prefix = std::string("scene/") + name + "/";
+        const auto selected = [&](const char* const kind) { return (prefix + kind).find(options.filter) != std::string::npos; };
+
+        // the larger scenes take a while to generate, which is skipped if none of their benchmarks is selected
+        if (!selected("build") && !selected("primary") && !selected("incoherent") && !selected("shadow"))
+            continue;
+
+        scene* const sc = create_triangle_scene(triangle_count);
+        const size_t triangles = sc->primitive_count();
+        const std::vector<std::pair<std::string, double>> parameters = { { "triangles", double(triangles) } };
+        pcg32 rng(2);
+        std::vector<ray3> primary;
+        std::vector<ray3> incoherent;
+
+        // coherent camera rays through a square image of the whole lattice
+        render_configuration config = make_configuration(IMAGE_SIZE, IMAGE_SIZE);
+        const float size = float(IMAGE_SIZE);
+
+        config.camera.position = vec3(4, 4, 9);
+        config.camera.look_at = vec3::Zero;
+        primary.reserve(RAY_COUNT);
+        incoherent.reserve(RAY_COUNT);
+
+        for (size_t i = 0; i < RAY_COUNT; ++i)
+            primary.push_back(CreateRay3(config, size, size, (i % IMAGE_SIZE) / size * 2 - 1, 1 - (i / IMAGE_SIZE) / size * 2));
+
+        // rays of random origins within the lattice and random directions, like the secondary rays of diffuse surfaces
+        for (size_t i = 0; i < RAY_COUNT; ++i)
+            incoherent.emplace_back(random_point(&rng, EXTENT), random_direction(&rng));
+
+        run_benchmark(options, results, make_result(prefix + "build", "scene", "triangles/s", triangles, parameters), [&]
+        {
+            sc->rebuild_acceleration_structure();
+
+            return sc->triangles.size();
+        });
+
+        sc->update_acceleration_structure();
+
+        for (const auto& [kind, rays] : { std::make_pair("primary", &primary), std::make_pair("incoherent", &incoherent) })
+            run_benchmark(options, results, make_result(prefix + kind, "scene", "rays/s", RAY_COUNT, parameters), [&, rays = rays]
+            {
+                size_t hits = 0;
+
+                for (const ray3& ray : *rays)
+                {
+                    hit_test hit = hit_test();
+                    primitive* hit_primitive = nullptr;
+
+                    hits += sc->intersect(ray, &hit, &hit_primitive);
+                }
+
+                return hits;
+            });
+
+        // occlusion tests of the incoherent rays over a fixed distance, as shadow rays towards nearby lights
+        run_benchmark(options, results, make_result(prefix + "shadow", "scene", "rays/s", RAY_COUNT, parameters), [&]
+        {
+            size_t occluded = 0;
+
+            for (const ray3& ray : incoherent)
+                occluded += sc->occluded(ray, EXTENT / 2);
+
+            return occluded;
+        });
+
+        DeleteScene3(sc);
+    }
+}
+
+static void run_frame_benchmarks(const benchmark_options& options, std::vector<benchmark_result>* const results)
+{
+    const size_t hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> thread_counts;
+
+    for (size_t threads = 1; threads < hardware_threads; threads *= 2)
+        thread_counts.push_back(threads);
+
+    thread_counts.push_back(hardware_threads);
+
+    scene* const sc = CreateScene3();
+
+    for (const auto& [width, height] : { std::make_pair(320, 240), std::make_pair(640, 480), std::make_pair(1280, 720) })
+        for (const size_t threads : thread_counts)
+        {
+            render_configuration config = make_configuration(width, height);
+
+            config.thread_count = threads;
+
+            const size_t pixels = size_t(width) * height;
+            std::vector<char> buffer(pixels * pixel_encoder(config.output_format, identity, 0).pixel_size());
+            const std::string name = "frame/" + std::to_string(width) + "x" + std::to_string(height) + "/threads:" + std::to_string(threads);
+
+            run_benchmark(options, results, make_result(name, "frame", "pixels/s", pixels, { { "width", width }, { "height", height }, { "threads", double(threads) } }), [&]
+            {
+                RenderImage3(sc, config, buffer.data());
+
+                return size_t(buffer[pixels / 2]);
+            });
+        }
+
+    DeleteScene3(sc);
+}
+
+static std::string escape_json(const std::string& text)
+{
+    std::ostringstream escaped;
+
+    for (const char c : text)
+        if (c == '"' || c == '\\')
+            escaped << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20)
+            escaped << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec;
+        else
+            escaped << c;
+
+    return escaped.str();
+}
+
+static const char* kernel_isa_name(const kernel_isa isa) noexcept
+{
+    switch (isa)
+    {
+        case kernel_isa::avx2:
+            return "avx2";
+        case kernel_isa::sse:
+            return "sse";
+        case kernel_isa::scalar:
+        default:
+            return "scalar";
+    }
+}
+
+static void write_json(std::ostream& out, const benchmark_options& options, const std::vector<benchmark_result>& results)
+{
+    const std::time_t now = std::time(nullptr);
+    char timestamp[32];
+
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+#if defined(__clang__)
+    const std::string compiler = "clang " __clang_version__;
+#elif defined(__GNUC__)
+    const std::string compiler = "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+    const std::string compiler = "msvc " + std::to_string(_MSC_FULL_VER);
+#else
+    const std::string compiler = "unknown";
+#endif
+
+    // the triangle kernel is chosen at runtime, so a build with SSE vectors may still intersect with AVX2 or fall back to the scalar kernel
+#if VEC_SSE
+    const std::string vec_backend = "sse";
+#elif VEC_NEON
+    const std::string vec_backend = "neon";
+#else
+    const std::string vec_backend = "none";
+#endif
+
+    out << std::setprecision(9)
+        << "{" << std::endl
+        << "  \"context\": {" << std::endl
+        << "    \"label\": \"" << escape_json(options.label) << "\"," << std::endl
+        << "    \"timestamp\": \"" << timestamp << "\"," << std::endl
+        << "    \"compiler\": \"" << escape_json(compiler) << "\"," << std::endl
+        << "    \"simd\": \"" << kernel_isa_name(active_kernel_isa) << "\"," << std::endl
+        << "    \"vec_backend\": \"" << vec_backend << "\"," << std::endl
+        << "    \"hardware_threads\": " << std::thread::hardware_concurrency() << "," << std::endl
+        << "    \"repetitions\": " << options.repetitions << "," << std::endl
+        << "    \"minimum_time_ms\": " << options.minimum_seconds * 1000 << std::endl
+        << "  }," << std::endl
+        << "  \"benchmarks\": [";
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const benchmark_result& result = results[i];
+        const auto [fastest, slowest] = std::minmax_element(result.seconds.begin(), result.seconds.end());
+        const double median = result.median_seconds();
+
+        out << (i ? "," : "") << std::endl
+            << "    {" << std::endl
+            << "      \"name\": \"" << escape_json(result.name) << "\"," << std::endl
+            << "      \"group\": \"" << escape_json(result.group) << "\"," << std::endl;
+
+        for (const auto& [parameter, value] : result.parameters)
+            out << "      \"" << escape_json(parameter) << "\": " << value << "," << std::endl;
+
+        out << "      \"iterations\": " << result.iterations << "," << std::endl
+            << "      \"items_per_iteration\": " << result.items_per_call << "," << std::endl
+            << "      \"unit\": \"" << escape_json(result.unit) << "\"," << std::endl
+            << "      \"items_per_second\": " << double(result.items_per_call) * result.iterations / median << "," << std::endl
+            << "      \"ns_per_item\": { \"median\": " << result.nanoseconds_per_item(median)
+            << ", \"min\": " << result.nanoseconds_per_item(*fastest)
+            << ", \"max\": " << result.nanoseconds_per_item(*slowest) << " }" << std::endl
+            << "    }";
+    }
+
+    out << std::endl << "  ]" << std::endl << "}" << std::endl;
+}
+
+static void print_usage(const char* const name)
+{
+    std::cerr << "Usage: " << name << " [options]" << std::endl
+              << "  --output <file>         JSON report. default: the standard output" << std::endl
+              << "  --filter <text>         only run benchmarks whose name contains the text, e.g. 'micro/', 'scene/1M' or 'frame/'. default: all" << std::endl
+              << "  --min-time <ms>         minimum duration of each repetition. default: 200" << std::endl
+              << "  --repetitions <count>   repetitions of each benchmark, of which the median is reported. default: 5" << std::endl
+              << "  --label <text>          label of the build, which is copied into the report" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    std::string output;
+    benchmark_options options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+
+        if (arg == "--help" || arg == "-h")
+        {
+            print_usage(argv[0]);
+
+            return 0;
+        }
+        else if (i + 1 >= argc)
+        {
+            print_usage(argv[0]);
+
+            return 1;
+        }
+        else if (arg == "--output")
+            output = argv[++i];
+        else if (arg == "--filter")
+            options.filter = argv[++i];
+        else if (arg == "--min-time")
+            options.minimum_seconds = std::stod(argv[++i]) / 1000;
+        else if (arg == "--repetitions")
+            options.repetitions = std::max<size_t>(1, std::stoul(argv[++i]));
+        else if (arg == "--label")
+            options.label = argv[++i];
+        else
+        {
+            print_usage(argv[0]);
+
+            return 1;
+        }
+    }
+
+    std::vector<benchmark_result> results;
+
+    run_micro_benchmarks(options, &results);
+    run_scene_benchmarks(options, &results);
+    run_frame_benchmarks(options, &results);
+
+    if (output.empty())
+        write_json(std::cout, options, results);
+    else
+    {
+        std::ofstream file(output);
+
+        write_json(file, options, results);
+
+        if (!file)
+        {
+            std::cerr << "Unable to write '" << output << "'." << std::endl;
+
+            return 1;
+        }
+    }
+
+    return 0;
+}
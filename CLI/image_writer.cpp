@@ -0,0 +1,429 @@
+#include "image_writer.hpp"
+
+#include <cctype>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+
+template<typename T>
+static inline void write_le(std::ostream& stream, const T value)
+{
+    unsigned char bytes[sizeof(T)];
+
+    std::memcpy(bytes, &value, sizeof(T));
+
+    // all supported hosts are little-endian, which the binary formats below are as well
+    stream.write(reinterpret_cast<const char*>(bytes), sizeof(T));
+}
+
+static inline void write_be(std::ostream& stream, const uint32_t value)
+{
+    const unsigned char bytes[4] = { uint8_t(value >> 24), uint8_t(value >> 16), uint8_t(value >> 8), uint8_t(value) };
+
+    stream.write(reinterpret_cast<const char*>(bytes), 4);
+}
+
+
+// Binary PPM (P6) with 8 bit sRGB channels. The alpha channel is dropped.
+class ppm_writer
+    : public image_writer
+{
+    std::vector<unsigned char> _row;
+
+public:
+    ppm_writer(const std::string& path, const int width, const int height)
+        : image_writer(path, width, height)
+        , _row(size_t(width) * 3)
+    {
+    }
+
+    framebuffer_format format() const noexcept override
+    {
+        return bgra8_srgb;
+    }
+
+    bool begin() override
+    {
+        _file << "P6\n" << _width << " " << _height << "\n255\n";
+
+        return bool(_file);
+    }
+
+    bool write_rows(const void* const pixels, const int, const int row_count) override
+    {
+        const unsigned char* source = static_cast<const unsigned char*>(pixels);
+
+        for (int y = 0; y < row_count; ++y)
+        {
+            for (int x = 0; x < _width; ++x, source += 4)
+            {
+                _row[x * 3] = source[2];
+                _row[x * 3 + 1] = source[1];
+                _row[x * 3 + 2] = source[0];
+            }
+
+            _file.write(reinterpret_cast<const char*>(_row.data()), _row.size());
+        }
+
+        return bool(_file);
+    }
+};
+
+
+// PNG with 8 bit sRGB RGB pixels. The alpha channel is dropped as for PPM, as the accumulated alpha of the shading does not describe coverage. Every band
+// is written as one IDAT chunk, which continues the image's single zlib stream. Without zlib, the stream consists of uncompressed deflate blocks, which
+// every decoder reads as well.
+class png_writer
+    : public image_writer
+{
+    static constexpr size_t STORED_BLOCK_SIZE = 65535;
+
+    std::vector<unsigned char> _filtered;
+    std::vector<unsigned char> _chunk;
+    uint32_t _crc_table[256];
+#ifdef HAVE_ZLIB
+    z_stream _stream = z_stream();
+#else
+    uint32_t _adler_a = 1;
+    uint32_t _adler_b = 0;
+#endif
+
+
+    uint32_t crc(const unsigned char* const data, const size_t size, uint32_t value = 0xffffffffu) const noexcept
+    {
+        for (size_t i = 0; i < size; ++i)
+            value = _crc_table[(value ^ data[i]) & 0xff] ^ (value >> 8);
+
+        return value;
+    }
+
+    void write_chunk(const char* const type, const unsigned char* const data, const size_t size)
+    {
+        write_be(_file, uint32_t(size));
+        _file.write(type, 4);
+        _file.write(reinterpret_cast<const char*>(data), size);
+        write_be(_file, crc(data, size, crc(reinterpret_cast<const unsigned char*>(type), 4)) ^ 0xffffffffu);
+    }
+
+    // Compresses the filtered rows into '_chunk'. The last call completes the zlib stream.
+    void deflate_rows(const bool last)
+    {
+        _chunk.clear();
+#ifdef HAVE_ZLIB
+        unsigned char output[65536];
+
+        _stream.next_in = _filtered.data();
+        _stream.avail_in = uInt(_filtered.size());
+
+        do
+        {
+            _stream.next_out = output;
+            _stream.avail_out = sizeof(output);
+            deflate(&_stream, last ? Z_FINISH : Z_NO_FLUSH);
+            _chunk.insert(_chunk.end(), output, output + sizeof(output) - _stream.avail_out);
+        }
+        while (_stream.avail_out == 0 || _stream.avail_in);
+#else
+        if (_filtered.empty() && !last)
+            return;
+
+        for (size_t offset = 0; offset < _filtered.size() || (last && offset == 0); offset += STORED_BLOCK_SIZE)
+        {
+            const size_t size = std::min(STORED_BLOCK_SIZE, _filtered.size() - offset);
+            const bool final = last && offset + size == _filtered.size();
+
+            _chunk.push_back(final);
+            _chunk.push_back(uint8_t(size));
+            _chunk.push_back(uint8_t(size >> 8));
+            _chunk.push_back(uint8_t(~size));
+            _chunk.push_back(uint8_t(~size >> 8));
+            _chunk.insert(_chunk.end(), _filtered.begin() + offset, _filtered.begin() + offset + size);
+        }
+
+        for (const unsigned char byte : _filtered)
+        {
+            _adler_a = (_adler_a + byte) % 65521;
+            _adler_b = (_adler_b + _adler_a) % 65521;
+        }
+
+        if (last)
+            for (const uint32_t shift : { 24, 16, 8, 0 })
+                _chunk.push_back(uint8_t(((_adler_b << 16) | _adler_a) >> shift));
+#endif
+    }
+
+public:
+    png_writer(const std::string& path, const int width, const int height)
+        : image_writer(path, width, height)
+    {
+        for (uint32_t n = 0; n < 256; ++n)
+        {
+            uint32_t value = n;
+
+            for (int bit = 0; bit < 8; ++bit)
+                value = value & 1 ? 0xedb88320u ^ (value >> 1) : value >> 1;
+
+            _crc_table[n] = value;
+        }
+    }
+
+    ~png_writer() override
+    {
+#ifdef HAVE_ZLIB
+        deflateEnd(&_stream);
+#endif
+    }
+
+    framebuffer_format format() const noexcept override
+    {
+        return bgra8_srgb;
+    }
+
+    bool begin() override
+    {
+        static const unsigned char SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+        // 8 bits per channel, RGB, deflate, adaptive filtering, no interlacing
+        const unsigned char header[13] = {
+            uint8_t(_width >> 24), uint8_t(_width >> 16), uint8_t(_width >> 8), uint8_t(_width),
+            uint8_t(_height >> 24), uint8_t(_height >> 16), uint8_t(_height >> 8), uint8_t(_height),
+            8, 2, 0, 0, 0
+        };
+        // perceptual rendering intent
+        const unsigned char srgb = 0;
+
+        _file.write(reinterpret_cast<const char*>(SIGNATURE), sizeof(SIGNATURE));
+        write_chunk("IHDR", header, sizeof(header));
+        write_chunk("sRGB", &srgb, 1);
+#ifdef HAVE_ZLIB
+        if (deflateInit(&_stream, Z_DEFAULT_COMPRESSION) != Z_OK)
+            return false;
+#else
+        const unsigned char zlib_header[2] = { 0x78, 0x01 };
+
+        write_chunk("IDAT", zlib_header, sizeof(zlib_header));
+#endif
+        return bool(_file);
+    }
+
+    bool write_rows(const void* const pixels, const int, const int row_count) override
+    {
+        const unsigned char* source = static_cast<const unsigned char*>(pixels);
+
+        _filtered.resize(size_t(row_count) * (size_t(_width) * 3 + 1));
+
+        unsigned char* target = _filtered.data();
+
+        for (int y = 0; y < row_count; ++y)
+        {
+            unsigned char previous[3] = { 0, 0, 0 };
+
+            // the 'sub' filter stores the difference to the pixel on the left, which compresses smooth gradients well
+            *target++ = 1;
+
+            for (int x = 0; x < _width; ++x, source += 4, target += 3)
+            {
+                const unsigned char rgb[3] = { source[2], source[1], source[0] };
+
+                for (int c = 0; c < 3; ++c)
+                {
+                    target[c] = uint8_t(rgb[c] - previous[c]);
+                    previous[c] = rgb[c];
+                }
+            }
+        }
+
+        deflate_rows(false);
+
+        if (!_chunk.empty())
+            write_chunk("IDAT", _chunk.data(), _chunk.size());
+
+        return bool(_file);
+    }
+
+    bool end() override
+    {
+        _filtered.clear();
+        deflate_rows(true);
+        write_chunk("IDAT", _chunk.data(), _chunk.size());
+        write_chunk("IEND", nullptr, 0);
+
+        return image_writer::end();
+    }
+};
+
+
+// Uncompressed scanline OpenEXR with half float RGBA channels. As every scanline has the same size, the offset table is known up front.
+class exr_writer
+    : public image_writer
+{
+    std::vector<uint16_t> _line;
+    std::streamoff _data_offset = 0;
+
+
+    template<typename T>
+    void write_attribute(const char* const name, const char* const type, const T& value)
+    {
+        _file.write(name, std::strlen(name) + 1);
+        _file.write(type, std::strlen(type) + 1);
+        write_le(_file, int32_t(sizeof(T)));
+        write_le(_file, value);
+    }
+
+    inline size_t line_size() const noexcept
+    {
+        return size_t(_width) * 4 * sizeof(uint16_t);
+    }
+
+public:
+    exr_writer(const std::string& path, const int width, const int height)
+        : image_writer(path, width, height)
+        , _line(size_t(width) * 4)
+    {
+    }
+
+    framebuffer_format format() const noexcept override
+    {
+        return rgba16f;
+    }
+
+    bool begin() override
+    {
+        struct box2i { int32_t x_min, y_min, x_max, y_max; };
+        struct v2f { float x, y; };
+        // channels are stored in alphabetical order
+        const char* const channels[4] = { "A", "B", "G", "R" };
+        std::stringstream list;
+
+        for (const char* const channel : channels)
+        {
+            list.write(channel, 2);
+            // half floats, not linear, three reserved bytes, no subsampling
+            write_le(list, int32_t(1));
+            write_le(list, uint32_t(0));
+            write_le(list, int32_t(1));
+            write_le(list, int32_t(1));
+        }
+
+        list.put(0);
+
+        const std::string channel_list = list.str();
+        const box2i window = { 0, 0, _width - 1, _height - 1 };
+
+        write_le(_file, uint32_t(20000630));
+        write_le(_file, uint32_t(2));
+        _file.write("channels\0chlist", 16);
+        write_le(_file, int32_t(channel_list.size()));
+        _file.write(channel_list.data(), channel_list.size());
+        write_attribute("compression", "compression", uint8_t(0));
+        write_attribute("dataWindow", "box2i", window);
+        write_attribute("displayWindow", "box2i", window);
+        write_attribute("lineOrder", "lineOrder", uint8_t(0));
+        write_attribute("pixelAspectRatio", "float", 1.f);
+        write_attribute("screenWindowCenter", "v2f", v2f{ 0, 0 });
+        write_attribute("screenWindowWidth", "float", 1.f);
+        _file.put(0);
+
+        _data_offset = std::streamoff(_file.tellp()) + std::streamoff(_height) * 8;
+
+        for (int y = 0; y < _height; ++y)
+            write_le(_file, uint64_t(_data_offset + std::streamoff(y) * (8 + line_size())));
+
+        return bool(_file);
+    }
+
+    bool write_rows(const void* const pixels, const int first_row, const int row_count) override
+    {
+        const uint16_t* source = static_cast<const uint16_t*>(pixels);
+
+        for (int y = 0; y < row_count; ++y, source += size_t(_width) * 4)
+        {
+            // interleaved RGBA pixels become planar A, B, G and R lines
+            for (int x = 0; x < _width; ++x)
+            {
+                _line[x] = source[x * 4 + 3];
+                _line[_width + x] = source[x * 4 + 2];
+                _line[_width * 2 + x] = source[x * 4 + 1];
+                _line[_width * 3 + x] = source[x * 4];
+            }
+
+            write_le(_file, int32_t(first_row + y));
+            write_le(_file, int32_t(line_size()));
+            _file.write(reinterpret_cast<const char*>(_line.data()), line_size());
+        }
+
+        return bool(_file);
+    }
+};
+
+
+// Portable float map with 32 bit float RGB channels. PFM stores its rows from bottom to top, so every band is written to its final place in the file.
+class pfm_writer
+    : public image_writer
+{
+    std::vector<float> _row;
+    std::streamoff _data_offset = 0;
+
+public:
+    pfm_writer(const std::string& path, const int width, const int height)
+        : image_writer(path, width, height)
+        , _row(size_t(width) * 3)
+    {
+    }
+
+    framebuffer_format format() const noexcept override
+    {
+        return argb32f;
+    }
+
+    bool begin() override
+    {
+        // a negative scale marks little-endian data
+        _file << "PF\n" << _width << " " << _height << "\n-1.0\n";
+        _data_offset = _file.tellp();
+
+        return bool(_file);
+    }
+
+    bool write_rows(const void* const pixels, const int first_row, const int row_count) override
+    {
+        const ARGB* source = static_cast<const ARGB*>(pixels);
+        const std::streamoff row_size = std::streamoff(_row.size()) * sizeof(float);
+
+        for (int y = 0; y < row_count; ++y)
+        {
+            for (int x = 0; x < _width; ++x, ++source)
+            {
+                _row[x * 3] = source->R;
+                _row[x * 3 + 1] = source->G;
+                _row[x * 3 + 2] = source->B;
+            }
+
+            _file.seekp(_data_offset + (_height - 1 - first_row - y) * row_size);
+            _file.write(reinterpret_cast<const char*>(_row.data()), row_size);
+        }
+
+        return bool(_file);
+    }
+};
+
+
+std::unique_ptr<image_writer> image_writer::create(const std::string& path, const int width, const int height)
+{
+    const size_t dot = path.find_last_of('.');
+    std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](const unsigned char c) { return char(std::tolower(c)); });
+
+    if (extension == "ppm")
+        return std::make_unique<ppm_writer>(path, width, height);
+    else if (extension == "png")
+        return std::make_unique<png_writer>(path, width, height);
+    else if (extension == "exr")
+        return std::make_unique<exr_writer>(path, width, height);
+    else if (extension == "pfm")
+        return std::make_unique<pfm_writer>(path, width, height);
+    else
+        return nullptr;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "pixel_encoder.hpp"
+
+#include <fstream>
+
+
+// Writes an image file band by band while the image is being rendered, so that the whole image never has to be held in memory. Every writer requests
+// the framebuffer format in which it wants its rows to be rendered ('format'), which it then only has to rearrange into the file's layout.
+class image_writer
+{
+protected:
+    std::ofstream _file;
+    int _width;
+    int _height;
+
+
+    image_writer(const std::string& path, const int width, const int height)
+        : _file(path, std::ios::binary)
+        , _width(width)
+        , _height(height)
+    {
+    }
+
+public:
+    virtual ~image_writer() = default;
+
+    // Creates the writer for the file type given by the extension of 'path' (.ppm, .png, .exr or .pfm). Returns null for unknown extensions.
+    static std::unique_ptr<image_writer> create(const std::string& path, const int width, const int height);
+
+    virtual framebuffer_format format() const noexcept = 0;
+
+    // Writes the file header. Returns false if the file cannot be written.
+    virtual bool begin() = 0;
+
+    // Writes 'row_count' rows starting at 'first_row', whose pixels are given in the writer's format. Bands are passed from top to bottom.
+    virtual bool write_rows(const void* const pixels, const int first_row, const int row_count) = 0;
+
+    // Completes the file after the last band.
+    virtual bool end()
+    {
+        _file.flush();
+
+        return bool(_file);
+    }
+};
@@ -0,0 +1,211 @@
+#include "3D/ray_tracer.hpp"
+#include "image_writer.hpp"
+
+using namespace ray_tracer_3d;
+
+
+static void print_usage(const char* const name)
+{
+    std::cerr << "Usage: " << name << " [options]" << std::endl
+              << "  --scene <file>          scene file in text or binary form, or an OBJ or PLY mesh. default: the built-in demo scene" << std::endl
+              << "  --save-scene <file>     write the scene in binary form and exit" << std::endl
+              << "  --output <file>         output image (.ppm, .png, .exr or .pfm). default: render.ppm" << std::endl
+              << "  --width <pixels>        horizontal resolution. default: 480" << std::endl
+              << "  --height <pixels>       vertical resolution. default: 360" << std::endl
+              << "  --subpixels <count>     subpixels per pixel and axis. default: 1" << std::endl
+              << "  --samples <count>       samples per subpixel. default: 1" << std::endl
+              << "  --iterations <count>    maximum ray depth. default: 8" << std::endl
+              << "  --threads <count>       render threads, 0 for all hardware threads. default: 0" << std::endl
+              << "  --tile-size <pixels>    tile edge length, 0 for the default. default: 0" << std::endl
+              << "  --tile-order <order>    scanline, morton or hilbert. default: hilbert" << std::endl
+              << "  --packets <size>        primary ray packets of 1x1, 2x2 or 4x4 rays. default: 1" << std::endl
+              << "  --seed <value>          seed of the sample jitter. default: 0" << std::endl
+              << "  --adaptive <threshold>  stop sampling pixels whose standard error is below the threshold, and spend the saved samples on noisy pixels. default: 0 (off)" << std::endl
+              << "  --min-samples <count>   samples per pixel before adaptive sampling tests it, 0 for the default. default: 0" << std::endl
+              << "  --tonemap <operator>    identity, reinhard or aces. default: identity" << std::endl
+              << "  --exposure <stops>      exposure applied before tone mapping. default: 0" << std::endl
+              << "  --band-rows <rows>      rows rendered and written at once, 0 for eight tile rows. default: 0" << std::endl
+              << "  --debug                 print render statistics" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    std::string output = "render.ppm";
+    std::string scene_path;
+    std::string saved_scene_path;
+    int band_rows = 0;
+    render_configuration config = render_configuration();
+
+    config.horizontal_resolution = 480;
+    config.vertical_resolution = 360;
+    config.subpixels_per_pixel = 1;
+    config.samples_per_subpixel = 1;
+    config.maximum_iteration_count = 8;
+    config.camera.position = vec3(0, 0, 18);
+    config.camera.look_at = vec3(0, 3, 0);
+    config.camera.zoom_factor = 2;
+    config.camera.focal_length = 1;
+    config.mode = render_mode::realistic_colors;
+    config.background_color = ARGB(0, 0, 0, 0);
+    config.air_refraction_index = 1;
+    config.tile_ordering = tile_order::hilbert_curve;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+
+        if (arg == "--debug")
+            config.debug = true;
+        else if (arg == "--help" || arg == "-h")
+        {
+            print_usage(argv[0]);
+
+            return 0;
+        }
+        else if (!has_value)
+        {
+            print_usage(argv[0]);
+
+            return 1;
+        }
+        else if (arg == "--scene")
+            scene_path = argv[++i];
+        else if (arg == "--save-scene")
+            saved_scene_path = argv[++i];
+        else if (arg == "--output")
+            output = argv[++i];
+        else if (arg == "--width")
+            config.horizontal_resolution = std::stoul(argv[++i]);
+        else if (arg == "--height")
+            config.vertical_resolution = std::stoul(argv[++i]);
+        else if (arg == "--subpixels")
+            config.subpixels_per_pixel = std::stoul(argv[++i]);
+        else if (arg == "--samples")
+            config.samples_per_subpixel = std::stoul(argv[++i]);
+        else if (arg == "--iterations")
+            config.maximum_iteration_count = std::stoul(argv[++i]);
+        else if (arg == "--threads")
+            config.thread_count = std::stoul(argv[++i]);
+        else if (arg == "--seed")
+            config.seed = std::stoull(argv[++i]);
+        else if (arg == "--adaptive")
+            config.adaptive_threshold = std::stof(argv[++i]);
+        else if (arg == "--min-samples")
+            config.adaptive_minimum_samples = std::stoul(argv[++i]);
+        else if (arg == "--exposure")
+            config.exposure = std::stof(argv[++i]);
+        else if (arg == "--band-rows")
+            band_rows = std::stoi(argv[++i]);
+        else if (arg == "--tonemap")
+        {
+            const std::string tonemap = argv[++i];
+
+            config.tonemap = tonemap == "reinhard" ? reinhard : tonemap == "aces" ? aces_filmic : identity;
+        }
+        else if (arg == "--tile-size")
+            config.tile_size = std::stoul(argv[++i]);
+        else if (arg == "--tile-order")
+        {
+            const std::string order = argv[++i];
+
+            config.tile_ordering = order == "scanline" ? tile_order::scanline : order == "morton" ? tile_order::morton_curve : tile_order::hilbert_curve;
+        }
+        else if (arg == "--packets")
+        {
+            const std::string size = argv[++i];
+
+            config.packet_mode = size == "4" ? ray_packet_mode::packets_4x4 : size == "2" ? ray_packet_mode::packets_2x2 : ray_packet_mode::single_rays;
+        }
+        else
+        {
+            print_usage(argv[0]);
+
+            return 1;
+        }
+    }
+
+    const auto load_timer = std::chrono::high_resolution_clock::now();
+    scene* const scene = scene_path.empty() ? CreateScene3() : LoadScene3(scene_path.c_str());
+
+    if (!scene)
+        return 1;
+    else if (!scene_path.empty())
+        std::cout << "Loaded '" << scene_path << "' (" << scene->primitive_count() << " primitives, " << scene->instances.size() << " instances) in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - load_timer).count() << " ms" << std::endl;
+
+    if (!saved_scene_path.empty())
+    {
+        const bool saved = SaveScene3(scene, saved_scene_path.c_str());
+
+        DeleteScene3(scene);
+
+        return saved ? 0 : 1;
+    }
+
+    const int width = config.horizontal_resolution;
+    const int height = config.vertical_resolution;
+    const std::unique_ptr<image_writer> writer = image_writer::create(output, width, height);
+
+    if (!writer || !writer->begin())
+    {
+        if (writer)
+            std::cerr << "Unable to write '" << output << "'." << std::endl;
+        else
+            std::cerr << "Unknown image format of '" << output << "'." << std::endl;
+
+        DeleteScene3(scene);
+
+        return 1;
+    }
+
+    if (band_rows <= 0)
+        band_rows = 8 * (config.tile_size ? int(config.tile_size) : tile_scheduler::DEFAULT_TILE_SIZE);
+
+    config.output_format = writer->format();
+
+    // the image is rendered in bands of rows into two alternating buffers, so that one band is written to disk while the next one is rendered
+    const size_t band_size = size_t(width) * std::min(band_rows, height) * pixel_encoder(config.output_format, identity, 0).pixel_size();
+    std::vector<char> bands[2] = { std::vector<char>(band_size), std::vector<char>(band_size) };
+    std::future<bool> pending_write;
+    const auto timer = std::chrono::high_resolution_clock::now();
+    bool written = true;
+    float µs = 0;
+
+    for (int first_row = 0, band = 0; first_row < height && written; first_row += band_rows, band ^= 1)
+    {
+        const int row_count = std::min(band_rows, height - first_row);
+        const char* const pixels = bands[band].data();
+
+        µs += RenderRows3(scene, config, first_row, row_count, bands[band].data());
+
+        if (pending_write.valid())
+            written = pending_write.get();
+
+        pending_write = std::async(std::launch::async, [&writer, pixels, first_row, row_count]
+        {
+            return writer->write_rows(pixels, first_row, row_count);
+        });
+    }
+
+    if (pending_write.valid())
+        written &= pending_write.get();
+
+    written = written && writer->end();
+
+    const auto elapsed = std::chrono::high_resolution_clock::now() - timer;
+
+    DeleteScene3(scene);
+
+    std::cout << "Rendered " << width << "x" << height << " in " << µs / 1000.f << " ms ("
+              << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << " ms including output)" << std::endl;
+
+    if (!written)
+    {
+        std::cerr << "Unable to write '" << output << "'." << std::endl;
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "vec3.hpp"
+
+
+namespace ray_tracer_3d
+{
+    // Axis-aligned bounding box. The bounds are stored as plain float triples so that boxes can be copied around and tested without going through 'vec3'.
+    struct aabb
+    {
+        float min[3];
+        float max[3];
+
+
+        aabb() noexcept
+        {
+            min[0] = min[1] = min[2] = std::numeric_limits<float>::infinity();
+            max[0] = max[1] = max[2] = -std::numeric_limits<float>::infinity();
+        }
+
+        aabb(const vec3& a, const vec3& b) noexcept
+            : aabb()
+        {
+            extend(a);
+            extend(b);
+        }
+
+        inline bool is_empty() const noexcept
+        {
+            return min[0] > max[0] || min[1] > max[1] || min[2] > max[2];
+        }
+
+        inline void extend(const vec3& point) noexcept
+        {
+            min[0] = std::min(min[0], point.X);
+            min[1] = std::min(min[1], point.Y);
+            min[2] = std::min(min[2], point.Z);
+            max[0] = std::max(max[0], point.X);
+            max[1] = std::max(max[1], point.Y);
+            max[2] = std::max(max[2], point.Z);
+        }
+
+        inline void extend(const aabb& other) noexcept
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                min[i] = std::min(min[i], other.min[i]);
+                max[i] = std::max(max[i], other.max[i]);
+            }
+        }
+
+        inline float center(const int axis) const noexcept
+        {
+            return (min[axis] + max[axis]) * .5f;
+        }
+
+        inline float extent(const int axis) const noexcept
+        {
+            return max[axis] - min[axis];
+        }
+
+        inline int largest_axis() const noexcept
+        {
+            const float x = extent(0);
+            const float y = extent(1);
+            const float z = extent(2);
+
+            return x > y ? x > z ? 0 : 2 : y > z ? 1 : 2;
+        }
+
+        inline float surface_area() const noexcept
+        {
+            if (is_empty())
+                return 0.f;
+
+            const float x = extent(0);
+            const float y = extent(1);
+            const float z = extent(2);
+
+            return 2.f * (x * y + y * z + z * x);
+        }
+
+        // Slab test against a ray given by its origin and component-wise inverted direction.
+        // On success, 'entry' receives the distance at which the ray enters the box (clamped to zero).
+        inline bool intersect(const float* const __restrict origin, const float* const __restrict inv_direction, const float max_distance, float* const __restrict entry) const noexcept
+        {
+            float t_near = 0.f;
+            float t_far = max_distance;
+
+            for (int i = 0; i < 3; ++i)
+            {
+                const float t0 = (min[i] - origin[i]) * inv_direction[i];
+                const float t1 = (max[i] - origin[i]) * inv_direction[i];
+
+                t_near = std::max(t_near, std::min(t0, t1));
+                t_far = std::min(t_far, std::max(t0, t1));
+            }
+
+            *entry = t_near;
+
+            return t_near <= t_far;
+        }
+
+        TO_STRING(aabb, "MIN=" << min[0] << ", " << min[1] << ", " << min[2] << ",MAX=" << max[0] << ", " << max[1] << ", " << max[2]);
+    };
+};
@@ -0,0 +1,124 @@
+#include "affine_transform.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TRANSFORM_SSE 1
+#include <immintrin.h>
+#else
+#define TRANSFORM_SSE 0
+#endif
+
+using namespace ray_tracer_3d;
+
+
+affine_transform ray_tracer_3d::affine_transform::rotation(const float euler_x, const float euler_y, const float euler_z) noexcept
+{
+    if (euler_x == 0.f && euler_y == 0.f && euler_z == 0.f)
+        return affine_transform();
+
+    const float sx = std::sin(euler_x);
+    const float cx = std::cos(euler_x);
+    const float sy = std::sin(euler_y);
+    const float cy = std::cos(euler_y);
+    const float sz = std::sin(euler_z);
+    const float cz = std::cos(euler_z);
+
+    // Rz * Ry * Rx
+    return affine_transform(
+        cy * cz, sx * sy * cz - cx * sz, cx * sy * cz + sx * sz, 0,
+        cy * sz, sx * sy * sz + cx * cz, cx * sy * sz - sx * cz, 0,
+        -sy, sx * cy, cx * cy, 0
+    );
+}
+
+bool ray_tracer_3d::affine_transform::invert(affine_transform* const inverse) const noexcept
+{
+    // the inverse of the linear part is its adjugate divided by its determinant
+    const float cofactors[9] = {
+        m[5] * m[10] - m[6] * m[9], m[2] * m[9] - m[1] * m[10], m[1] * m[6] - m[2] * m[5],
+        m[6] * m[8] - m[4] * m[10], m[0] * m[10] - m[2] * m[8], m[2] * m[4] - m[0] * m[6],
+        m[4] * m[9] - m[5] * m[8], m[1] * m[8] - m[0] * m[9], m[0] * m[5] - m[1] * m[4],
+    };
+    const float det = m[0] * cofactors[0] + m[1] * cofactors[3] + m[2] * cofactors[6];
+
+    if (std::abs(det) < std::numeric_limits<float>::min())
+        return false;
+
+    const float inv_determinant = 1.f / det;
+    float* const result = inverse->m;
+
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int column = 0; column < 3; ++column)
+            result[4 * row + column] = cofactors[3 * row + column] * inv_determinant;
+
+        // the inverse translation is the negated translation transformed by the inverse linear part
+        result[4 * row + 3] = -(result[4 * row] * m[3] + result[4 * row + 1] * m[7] + result[4 * row + 2] * m[11]);
+    }
+
+    return true;
+}
+
+// Transforms packed XYZ triples. Four triples at a time are loaded as three registers and transposed into X, Y and Z lanes, which are transformed with the
+// same operation order as the scalar code and transposed back. The tail is transformed one triple at a time.
+template <bool translate>
+static void transform_triples(const float* const m, const float* const input, float* const output, const size_t count) noexcept
+{
+    size_t i = 0;
+
+#if TRANSFORM_SSE
+    const __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]), m3 = _mm_set1_ps(m[3]);
+    const __m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]), m7 = _mm_set1_ps(m[7]);
+    const __m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]), m11 = _mm_set1_ps(m[11]);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        // a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+        const __m128 a = _mm_loadu_ps(input + 3 * i);
+        const __m128 b = _mm_loadu_ps(input + 3 * i + 4);
+        const __m128 c = _mm_loadu_ps(input + 3 * i + 8);
+        const __m128 x = _mm_shuffle_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 0, 0)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 tx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, x), _mm_mul_ps(m1, y)), _mm_mul_ps(m2, z));
+        __m128 ty = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m4, x), _mm_mul_ps(m5, y)), _mm_mul_ps(m6, z));
+        __m128 tz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m8, x), _mm_mul_ps(m9, y)), _mm_mul_ps(m10, z));
+
+        if constexpr (translate)
+        {
+            tx = _mm_add_ps(tx, m3);
+            ty = _mm_add_ps(ty, m7);
+            tz = _mm_add_ps(tz, m11);
+        }
+
+        _mm_storeu_ps(output + 3 * i, _mm_shuffle_ps(_mm_shuffle_ps(tx, ty, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(tz, tx, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(output + 3 * i + 4, _mm_shuffle_ps(_mm_shuffle_ps(ty, tz, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(tx, ty, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(output + 3 * i + 8, _mm_shuffle_ps(_mm_shuffle_ps(tz, tx, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(ty, tz, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        const float x = input[3 * i], y = input[3 * i + 1], z = input[3 * i + 2];
+
+        output[3 * i] = m[0] * x + m[1] * y + m[2] * z;
+        output[3 * i + 1] = m[4] * x + m[5] * y + m[6] * z;
+        output[3 * i + 2] = m[8] * x + m[9] * y + m[10] * z;
+
+        if constexpr (translate)
+        {
+            output[3 * i] += m[3];
+            output[3 * i + 1] += m[7];
+            output[3 * i + 2] += m[11];
+        }
+    }
+}
+
+void ray_tracer_3d::affine_transform::transform_points(const float* const input, float* const output, const size_t count) const noexcept
+{
+    transform_triples<true>(m, input, output, count);
+}
+
+void ray_tracer_3d::affine_transform::transform_directions(const float* const input, float* const output, const size_t count) const noexcept
+{
+    transform_triples<false>(m, input, output, count);
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "vec3.hpp"
+
+
+namespace ray_tracer_3d
+{
+    // Affine 4x4 matrix whose last row is implicitly (0, 0, 0, 1). It is stored row-major as the three remaining rows, each consisting of the linear part
+    // followed by its translation component, so that transforms live on the stack and can be copied around without allocations.
+    struct affine_transform
+    {
+        float m[12];
+
+
+        // Creates the identity transform.
+        constexpr affine_transform() noexcept
+            : affine_transform(
+                1, 0, 0, 0,
+                0, 1, 0, 0,
+                0, 0, 1, 0
+            )
+        {
+        }
+
+        constexpr affine_transform(
+            const float m00, const float m01, const float m02, const float m03,
+            const float m10, const float m11, const float m12, const float m13,
+            const float m20, const float m21, const float m22, const float m23
+        ) noexcept
+            : m{ m00, m01, m02, m03, m10, m11, m12, m13, m20, m21, m22, m23 }
+        {
+        }
+
+        // Reads the 12 coefficients of the three rows.
+        constexpr explicit affine_transform(const float* const values) noexcept
+            : affine_transform(
+                values[0], values[1], values[2], values[3],
+                values[4], values[5], values[6], values[7],
+                values[8], values[9], values[10], values[11]
+            )
+        {
+        }
+
+        static constexpr affine_transform translation(const float x, const float y, const float z) noexcept
+        {
+            return affine_transform(
+                1, 0, 0, x,
+                0, 1, 0, y,
+                0, 0, 1, z
+            );
+        }
+
+        static inline affine_transform translation(const vec3& offset) noexcept
+        {
+            return translation(offset.X, offset.Y, offset.Z);
+        }
+
+        static constexpr affine_transform scaling(const float x, const float y, const float z) noexcept
+        {
+            return affine_transform(
+                x, 0, 0, 0,
+                0, y, 0, 0,
+                0, 0, z, 0
+            );
+        }
+
+        static inline affine_transform scaling(const vec3& factors) noexcept
+        {
+            return scaling(factors.X, factors.Y, factors.Z);
+        }
+
+        // Returns the rotation by the given Euler angles (in radians), which rotates around the X axis first, then around Y and finally around Z.
+        static affine_transform rotation(const float euler_x, const float euler_y, const float euler_z) noexcept;
+
+        static inline affine_transform rotation(EULER_ARG) noexcept
+        {
+            return rotation(euler_angles.X, euler_angles.Y, euler_angles.Z);
+        }
+
+        // Returns the transform which scales, then rotates and then translates.
+        static inline affine_transform create(const vec3& position, const vec3& scale = vec3(1, 1, 1), EULER_OPTARG) noexcept
+        {
+            affine_transform transform = rotation(euler_angles);
+
+            for (int row = 0; row < 3; ++row)
+            {
+                transform.m[4 * row] *= scale.X;
+                transform.m[4 * row + 1] *= scale.Y;
+                transform.m[4 * row + 2] *= scale.Z;
+            }
+
+            transform.m[3] = position.X;
+            transform.m[7] = position.Y;
+            transform.m[11] = position.Z;
+
+            return transform;
+        }
+
+        constexpr float determinant() const noexcept
+        {
+            return m[0] * (m[5] * m[10] - m[6] * m[9]) + m[1] * (m[6] * m[8] - m[4] * m[10]) + m[2] * (m[4] * m[9] - m[5] * m[8]);
+        }
+
+        // Computes the inverse transform. Returns false and leaves 'inverse' untouched if the transform is not invertible.
+        bool invert(affine_transform* const inverse) const noexcept;
+
+        inline vec3 transform_point(const vec3& point) const noexcept
+        {
+            return vec3(
+                m[0] * point.X + m[1] * point.Y + m[2] * point.Z + m[3],
+                m[4] * point.X + m[5] * point.Y + m[6] * point.Z + m[7],
+                m[8] * point.X + m[9] * point.Y + m[10] * point.Z + m[11]
+            );
+        }
+
+        // Transforms a direction by the linear part only, i.e. without translating it.
+        inline vec3 transform_direction(const vec3& direction) const noexcept
+        {
+            return vec3(
+                m[0] * direction.X + m[1] * direction.Y + m[2] * direction.Z,
+                m[4] * direction.X + m[5] * direction.Y + m[6] * direction.Z,
+                m[8] * direction.X + m[9] * direction.Y + m[10] * direction.Z
+            );
+        }
+
+        // Transforms a direction by the transpose of the linear part. Called on the inverse of a transform, this transforms surface normals such that they
+        // stay perpendicular to non-uniformly scaled surfaces. The result is not normalized.
+        inline vec3 transform_normal(const vec3& normal) const noexcept
+        {
+            return vec3(
+                m[0] * normal.X + m[4] * normal.Y + m[8] * normal.Z,
+                m[1] * normal.X + m[5] * normal.Y + m[9] * normal.Z,
+                m[2] * normal.X + m[6] * normal.Y + m[10] * normal.Z
+            );
+        }
+
+        // Transforms 'count' points stored as packed XYZ triples. 'input' and 'output' may be the same array. Uses SSE where available, with results that
+        // are bit-identical to 'transform_point'.
+        void transform_points(const float* const input, float* const output, const size_t count) const noexcept;
+
+        // Transforms 'count' directions stored as packed XYZ triples, like 'transform_points' but without translating them.
+        void transform_directions(const float* const input, float* const output, const size_t count) const noexcept;
+
+        // Returns the composition which applies 'other' first and this transform afterwards.
+        constexpr affine_transform operator*(const affine_transform& other) const noexcept
+        {
+            affine_transform result;
+
+            for (int row = 0; row < 3; ++row)
+            {
+                const float* const r = m + 4 * row;
+
+                for (int column = 0; column < 4; ++column)
+                    result.m[4 * row + column] = r[0] * other.m[column] + r[1] * other.m[4 + column] + r[2] * other.m[8 + column];
+
+                result.m[4 * row + 3] += r[3];
+            }
+
+            return result;
+        }
+
+        inline affine_transform& operator*=(const affine_transform& other) noexcept
+        {
+            return *this = *this * other;
+        }
+
+        constexpr bool operator==(const affine_transform& other) const noexcept
+        {
+            for (int i = 0; i < 12; ++i)
+                if (m[i] != other.m[i])
+                    return false;
+
+            return true;
+        }
+
+        TO_STRING(affine_transform, m[0] << ", " << m[1] << ", " << m[2] << ", " << m[3] << "; "
+                                 << m[4] << ", " << m[5] << ", " << m[6] << ", " << m[7] << "; "
+                                 << m[8] << ", " << m[9] << ", " << m[10] << ", " << m[11]);
+    };
+};
@@ -0,0 +1,361 @@
+#include "bvh.hpp"
+#include "../task_pool.hpp"
+
+using namespace ray_tracer_3d;
+
+
+void ray_tracer_3d::bvh::clear() noexcept
+{
+    _nodes.clear();
+    _indices.clear();
+    _node_count = 0;
+}
+
+void ray_tracer_3d::bvh::build(const std::vector<aabb>& bounds) noexcept
+{
+    const uint count = bounds.size();
+
+    clear();
+
+    if (!count)
+        return;
+
+    _indices.resize(count);
+
+    std::iota(_indices.begin(), _indices.end(), 0);
+
+    // a binary tree with N leaves has at most 2N - 1 nodes
+    _nodes.resize(2 * size_t(count) - 1);
+    _node_count = 1;
+
+    build_node(bounds, 0, 0, count, 0);
+
+    _nodes.resize(_node_count);
+    _nodes.shrink_to_fit();
+}
+
+bool ray_tracer_3d::bvh::refit(const std::vector<aabb>& bounds) noexcept
+{
+    if (_nodes.empty() || bounds.size() != _indices.size())
+        return false;
+
+    parallel_for(size_t(0), _nodes.size(), [&](const size_t index)
+    {
+        bvh_node& node = _nodes[index];
+
+        if (node.is_leaf())
+        {
+            node.bounds = aabb();
+
+            for (uint i = node.first, l = node.first + node.count; i < l; ++i)
+                node.bounds.extend(bounds[_indices[i]]);
+        }
+    });
+
+    // children are always stored after their parent, so a reverse sweep updates them before the parent is merged
+    for (size_t index = _nodes.size(); index-- > 0; )
+    {
+        bvh_node& node = _nodes[index];
+
+        if (!node.is_leaf())
+        {
+            node.bounds = _nodes[node.first].bounds;
+            node.bounds.extend(_nodes[node.first + 1].bounds);
+        }
+    }
+
+    return true;
+}
+
+void ray_tracer_3d::bvh::compute_bounds(const std::vector<aabb>& bounds, const uint begin, const uint end, aabb* const __restrict node_bounds, aabb* const __restrict centroid_bounds) const noexcept
+{
+    const auto process = [&](const uint first, const uint last, aabb* const __restrict boxes, aabb* const __restrict centroids)
+    {
+        for (uint i = first; i < last; ++i)
+        {
+            const aabb& box = bounds[_indices[i]];
+
+            boxes->extend(box);
+            centroids->extend(vec3(box.center(0), box.center(1), box.center(2)));
+        }
+    };
+    const uint chunk_count = (end - begin + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE;
+
+    *node_bounds = aabb();
+    *centroid_bounds = aabb();
+
+    if (chunk_count <= 1)
+        process(begin, end, node_bounds, centroid_bounds);
+    else
+    {
+        std::vector<aabb> partial(2 * size_t(chunk_count));
+
+        parallel_for(uint(0), chunk_count, [&](const uint chunk)
+        {
+            const uint first = begin + chunk * PARALLEL_CHUNK_SIZE;
+
+            process(first, std::min(end, first + PARALLEL_CHUNK_SIZE), &partial[2 * chunk], &partial[2 * chunk + 1]);
+        });
+
+        for (uint chunk = 0; chunk < chunk_count; ++chunk)
+        {
+            node_bounds->extend(partial[2 * chunk]);
+            centroid_bounds->extend(partial[2 * chunk + 1]);
+        }
+    }
+}
+
+void ray_tracer_3d::bvh::bin_primitives(const std::vector<aabb>& bounds, const uint begin, const uint end, const aabb& centroid_bounds, bvh_bin* const bins) const noexcept
+{
+    float scale[3];
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const float extent = centroid_bounds.extent(axis);
+
+        scale[axis] = extent > 0.f ? BIN_COUNT / extent : 0.f;
+    }
+
+    const auto process = [&](const uint first, const uint last, bvh_bin* const target)
+    {
+        for (uint i = first; i < last; ++i)
+        {
+            const aabb& box = bounds[_indices[i]];
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                const int bin = std::min(BIN_COUNT - 1, int((box.center(axis) - centroid_bounds.min[axis]) * scale[axis]));
+
+                target[axis * BIN_COUNT + bin].bounds.extend(box);
+                ++target[axis * BIN_COUNT + bin].count;
+            }
+        }
+    };
+    const uint chunk_count = (end - begin + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE;
+
+    if (chunk_count <= 1)
+        process(begin, end, bins);
+    else
+    {
+        std::vector<bvh_bin> partial(size_t(chunk_count) * 3 * BIN_COUNT);
+
+        parallel_for(uint(0), chunk_count, [&](const uint chunk)
+        {
+            const uint first = begin + chunk * PARALLEL_CHUNK_SIZE;
+
+            process(first, std::min(end, first + PARALLEL_CHUNK_SIZE), &partial[size_t(chunk) * 3 * BIN_COUNT]);
+        });
+
+        for (size_t i = 0; i < partial.size(); ++i)
+        {
+            bins[i % (3 * BIN_COUNT)].bounds.extend(partial[i].bounds);
+            bins[i % (3 * BIN_COUNT)].count += partial[i].count;
+        }
+    }
+}
+
+void ray_tracer_3d::bvh::build_node(const std::vector<aabb>& bounds, const uint node_index, const uint begin, const uint end, const int depth) noexcept
+{
+    bvh_node& node = _nodes[node_index];
+    const uint count = end - begin;
+    aabb centroid_bounds;
+
+    compute_bounds(bounds, begin, end, &node.bounds, &centroid_bounds);
+
+    node.first = begin;
+    node.count = count;
+
+    if (count <= 1 || depth >= MAX_DEPTH - 1)
+        return;
+
+    bvh_bin bins[3 * BIN_COUNT];
+    int best_axis = -1;
+    int best_split = 0;
+    float best_cost = std::numeric_limits<float>::infinity();
+
+    bin_primitives(bounds, begin, end, centroid_bounds, bins);
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (centroid_bounds.extent(axis) <= 0.f)
+            continue;
+
+        // sweep from the right to collect the cost of every right-hand side, then from the left to evaluate each split plane
+        const bvh_bin* const axis_bins = bins + axis * BIN_COUNT;
+        float right_areas[BIN_COUNT];
+        uint right_counts[BIN_COUNT];
+        aabb accumulated;
+        uint accumulated_count = 0;
+
+        for (int bin = BIN_COUNT - 1; bin > 0; --bin)
+        {
+            accumulated.extend(axis_bins[bin].bounds);
+            accumulated_count += axis_bins[bin].count;
+            right_areas[bin] = accumulated.surface_area();
+            right_counts[bin] = accumulated_count;
+        }
+
+        accumulated = aabb();
+        accumulated_count = 0;
+
+        for (int split = 1; split < BIN_COUNT; ++split)
+        {
+            accumulated.extend(axis_bins[split - 1].bounds);
+            accumulated_count += axis_bins[split - 1].count;
+
+            if (!accumulated_count || !right_counts[split])
+                continue;
+
+            const float cost = accumulated.surface_area() * accumulated_count + right_areas[split] * right_counts[split];
+
+            if (cost < best_cost)
+            {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = split;
+            }
+        }
+    }
+
+    const float area = node.bounds.surface_area();
+    const float leaf_cost = INTERSECTION_COST * count;
+    uint* const first = _indices.data() + begin;
+    uint* const last = _indices.data() + end;
+    uint* middle;
+
+    if (best_axis >= 0)
+    {
+        const float split_cost = TRAVERSAL_COST + INTERSECTION_COST * best_cost / std::max(area, std::numeric_limits<float>::min());
+
+        if (split_cost >= leaf_cost && count <= MAX_LEAF_SIZE)
+            return;
+
+        const float offset = centroid_bounds.min[best_axis];
+        const float scale = BIN_COUNT / centroid_bounds.extent(best_axis);
+
+        middle = std::partition(first, last, [&](const uint index)
+        {
+            return std::min(BIN_COUNT - 1, int((bounds[index].center(best_axis) - offset) * scale)) < best_split;
+        });
+    }
+    else if (count <= MAX_LEAF_SIZE)
+        return;
+    else
+    {
+        // all centroids coincide, so no split plane can separate them. fall back to a median split to keep the leaves small.
+        const int axis = node.bounds.largest_axis();
+
+        middle = first + count / 2;
+
+        std::nth_element(first, middle, last, [&](const uint a, const uint b)
+        {
+            return bounds[a].center(axis) < bounds[b].center(axis);
+        });
+    }
+
+    const uint split = begin + uint(middle - first);
+
+    if (split == begin || split == end)
+        return;
+
+    const uint left = _node_count.fetch_add(2);
+
+    node.first = left;
+    node.count = 0;
+
+    // both subtrees cover disjoint ranges of the index and node arrays, so large ones are built as independent tasks
+    if (count >= PARALLEL_BUILD_THRESHOLD)
+        parallel_invoke(
+            [&] { build_node(bounds, left, begin, split, depth + 1); },
+            [&] { build_node(bounds, left + 1, split, end, depth + 1); }
+        );
+    else
+    {
+        build_node(bounds, left, begin, split, depth + 1);
+        build_node(bounds, left + 1, split, end, depth + 1);
+    }
+}
+
+bool ray_tracer_3d::bvh::intersect(const std::vector<primitive*>& mesh, const triangle_store& triangles, const ray3& ray, hit_test* const __restrict result, primitive** const __restrict hit_primitive) const noexcept
+{
+    return closest_hit(ray, result->distance, [&](const uint first, const uint last)
+    {
+        return triangles.intersect(mesh, first, last, ray, result, hit_primitive);
+    });
+}
+
+bool ray_tracer_3d::bvh::occluded(const std::vector<primitive*>& mesh, const triangle_store& triangles, const ray3& ray, const float max_distance) const noexcept
+{
+    return any_hit(ray, max_distance, [&](const uint first, const uint last)
+    {
+        return triangles.occluded(mesh, first, last, ray, max_distance);
+    });
+}
+
+void ray_tracer_3d::bvh::intersect(const std::vector<primitive*>& mesh, const triangle_store& triangles, const ray_packet& packet, hit_test* const __restrict results, primitive** const __restrict hit_primitives) const noexcept
+{
+    if (_nodes.empty())
+        return;
+
+    const float leading_direction[3] = {
+        packet.rays[0]->direction.X,
+        packet.rays[0]->direction.Y,
+        packet.rays[0]->direction.Z,
+    };
+    float max_distance = 0.f;
+
+    for (int i = 0; i < packet.size; ++i)
+        max_distance = std::max(max_distance, results[i].distance);
+
+    // every inner node pops one entry and pushes two, so the stack never holds more than one entry per level (plus the root)
+    uint stack[MAX_DEPTH + 1];
+    int stack_size = 0;
+
+    stack[stack_size++] = 0;
+
+    while (stack_size)
+    {
+        const bvh_node& node = _nodes[stack[--stack_size]];
+        float entry;
+
+        if (!packet.may_intersect(node.bounds, max_distance) || packet.first_hit(node.bounds, results, &entry) < 0)
+            continue;
+
+        if (node.is_leaf())
+        {
+            max_distance = 0.f;
+
+            for (int i = 0; i < packet.size; ++i)
+            {
+                const float origin[3] = { packet.origin[0][i], packet.origin[1][i], packet.origin[2][i] };
+                const float inv_direction[3] = { packet.inv_direction[0][i], packet.inv_direction[1][i], packet.inv_direction[2][i] };
+
+                if (node.bounds.intersect(origin, inv_direction, results[i].distance, &entry))
+                    triangles.intersect(mesh, node.first, node.first + node.count, *packet.rays[i], results + i, hit_primitives + i);
+
+                max_distance = std::max(max_distance, results[i].distance);
+            }
+        }
+        else
+        {
+            // the packet shares roughly one direction, so the children are ordered by the projection of their centers onto it
+            const aabb& left = _nodes[node.first].bounds;
+            const aabb& right = _nodes[node.first + 1].bounds;
+            float projection = 0.f;
+
+            for (int axis = 0; axis < 3; ++axis)
+                projection += (left.center(axis) - right.center(axis)) * leading_direction[axis];
+
+            if (projection <= 0.f)
+            {
+                stack[stack_size++] = node.first + 1;
+                stack[stack_size++] = node.first;
+            }
+            else
+            {
+                stack[stack_size++] = node.first;
+                stack[stack_size++] = node.first + 1;
+            }
+        }
+    }
+}
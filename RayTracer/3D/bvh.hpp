@@ -0,0 +1,235 @@
+#pragma once
+
+#include "triangle_store.hpp"
+#include "ray_packet.hpp"
+
+
+namespace ray_tracer_3d
+{
+    struct bvh_node
+    {
+        aabb bounds;
+        // index of the left child (the right child is stored directly after it) for inner nodes, or the index of the first primitive reference for leaves
+        uint first;
+        // number of primitive references inside a leaf. zero for inner nodes.
+        uint count;
+
+
+        inline bool is_leaf() const noexcept
+        {
+            return count > 0;
+        }
+    };
+
+    // Bounding volume hierarchy over the primitives of a scene, built top-down using the binned surface area heuristic (SAH).
+    // Subtrees are built as parallel tasks, and the primitives of large nodes are binned in parallel chunks.
+    class bvh
+    {
+    public:
+        static constexpr uint INVALID_NODE = ~0u;
+        static constexpr int BIN_COUNT = 16;
+        static constexpr int MAX_DEPTH = 64;
+        static constexpr uint MAX_LEAF_SIZE = 8;
+        static constexpr uint PARALLEL_BUILD_THRESHOLD = 4096;
+        static constexpr uint PARALLEL_CHUNK_SIZE = 16384;
+        static constexpr float TRAVERSAL_COST = 1.f;
+        static constexpr float INTERSECTION_COST = 1.f;
+
+    private:
+        // bins are stored axis-major, i.e. as [axis * BIN_COUNT + bin]
+        struct bvh_bin
+        {
+            aabb bounds;
+            uint count = 0;
+        };
+
+        std::vector<bvh_node> _nodes;
+        std::vector<uint> _indices;
+        std::atomic<uint> _node_count = 0;
+
+        void compute_bounds(const std::vector<aabb>& bounds, const uint begin, const uint end, aabb* const __restrict node_bounds, aabb* const __restrict centroid_bounds) const noexcept;
+
+        void bin_primitives(const std::vector<aabb>& bounds, const uint begin, const uint end, const aabb& centroid_bounds, bvh_bin* const bins) const noexcept;
+
+        void build_node(const std::vector<aabb>& bounds, const uint node_index, const uint begin, const uint end, const int depth) noexcept;
+    public:
+        inline size_t primitive_count() const noexcept
+        {
+            return _indices.size();
+        }
+
+        inline const std::vector<uint>& primitive_indices() const noexcept
+        {
+            return _indices;
+        }
+
+        inline size_t node_count() const noexcept
+        {
+            return _nodes.size();
+        }
+
+        inline bool is_empty() const noexcept
+        {
+            return _nodes.empty();
+        }
+
+        void clear() noexcept;
+
+        // Builds the tree over the primitives with the given bounding boxes, which are identified by their index into 'bounds'.
+        void build(const std::vector<aabb>& bounds) noexcept;
+
+        // Recomputes the node bounds bottom-up while keeping the tree topology. This is only valid if the bounds still belong to the same primitives (e.g. after vertices have been moved)
+        // and returns false if the primitive count does not match, in which case a full rebuild is required.
+        bool refit(const std::vector<aabb>& bounds) noexcept;
+
+        // Finds the closest intersection along the given ray. Nodes are visited front-to-back and every node farther away than the closest hit found so far is skipped.
+        // 'result' must be initialized by the caller, as its distance is used as the maximum search distance. Triangles are tested against the given
+        // triangle store, which must have been built in the order of 'primitive_indices()'. All other primitives are tested through the mesh.
+        bool intersect(const std::vector<primitive*>& mesh, const triangle_store& triangles, const ray3& ray, hit_test* const __restrict result, primitive** const __restrict hit_primitive) const noexcept;
+
+        // Returns whether anything is hit closer than 'max_distance' along the given ray. The traversal stops at the first leaf reporting a hit, and
+        // since the search distance never shrinks, no node has to be re-tested against it when popped.
+        bool occluded(const std::vector<primitive*>& mesh, const triangle_store& triangles, const ray3& ray, const float max_distance) const noexcept;
+
+        // Finds the closest intersection of every ray in the packet. A node is culled if the packet's interval frustum misses it, and otherwise visited as soon as
+        // one of the rays hits it. 'results' and 'hit_primitives' hold one entry per ray and follow the same conventions as in 'intersect'.
+        void intersect(const std::vector<primitive*>& mesh, const triangle_store& triangles, const ray_packet& packet, hit_test* const __restrict results, primitive** const __restrict hit_primitives) const noexcept;
+
+        // Visits the leaves hit by the ray front-to-back and calls 'test_leaf(first, last)' with their range of primitive references, which returns
+        // whether it found a hit. 'distance' is the maximum search distance, which the leaf test is expected to shrink to the closest hit found so far.
+        // Returns whether any leaf test found a hit.
+        template<typename F>
+        bool closest_hit(const ray3& ray, const float& distance, const F& test_leaf) const noexcept
+        {
+            if (_nodes.empty())
+                return false;
+
+            const float origin[3] = { ray.origin.X, ray.origin.Y, ray.origin.Z };
+            const float inv_direction[3] = { 1.f / ray.direction.X, 1.f / ray.direction.Y, 1.f / ray.direction.Z };
+            float entry;
+
+            if (!_nodes[0].bounds.intersect(origin, inv_direction, distance, &entry))
+                return false;
+
+            struct stack_entry
+            {
+                uint node;
+                float entry;
+            } stack[MAX_DEPTH];
+            int stack_size = 0;
+            uint node_index = 0;
+            bool found = false;
+
+            while (true)
+            {
+                const bvh_node& node = _nodes[node_index];
+
+                if (node.is_leaf())
+                    found |= test_leaf(node.first, node.first + node.count);
+                else
+                {
+                    float entry_left, entry_right;
+                    const bool hit_left = _nodes[node.first].bounds.intersect(origin, inv_direction, distance, &entry_left);
+                    const bool hit_right = _nodes[node.first + 1].bounds.intersect(origin, inv_direction, distance, &entry_right);
+
+                    if (hit_left && hit_right)
+                    {
+                        // descend into the nearer child first and defer the farther one
+                        if (entry_left <= entry_right)
+                        {
+                            stack[stack_size++] = { node.first + 1, entry_right };
+                            node_index = node.first;
+                        }
+                        else
+                        {
+                            stack[stack_size++] = { node.first, entry_left };
+                            node_index = node.first + 1;
+                        }
+
+                        continue;
+                    }
+                    else if (hit_left || hit_right)
+                    {
+                        node_index = hit_left ? node.first : node.first + 1;
+
+                        continue;
+                    }
+                }
+
+                // pop the next deferred node, skipping all nodes which lie behind the closest hit found in the meantime
+                node_index = INVALID_NODE;
+
+                while (stack_size && node_index == INVALID_NODE)
+                {
+                    const stack_entry& next = stack[--stack_size];
+
+                    if (next.entry <= distance)
+                        node_index = next.node;
+                }
+
+                if (node_index == INVALID_NODE)
+                    return found;
+            }
+        }
+
+        // Visits the leaves hit by the ray closer than 'max_distance' until 'test_leaf(first, last)' reports a hit. Returns whether one did.
+        template<typename F>
+        bool any_hit(const ray3& ray, const float max_distance, const F& test_leaf) const noexcept
+        {
+            if (_nodes.empty())
+                return false;
+
+            const float origin[3] = { ray.origin.X, ray.origin.Y, ray.origin.Z };
+            const float inv_direction[3] = { 1.f / ray.direction.X, 1.f / ray.direction.Y, 1.f / ray.direction.Z };
+            float entry;
+
+            if (!_nodes[0].bounds.intersect(origin, inv_direction, max_distance, &entry))
+                return false;
+
+            uint stack[MAX_DEPTH];
+            int stack_size = 0;
+            uint node_index = 0;
+
+            while (true)
+            {
+                const bvh_node& node = _nodes[node_index];
+
+                if (node.is_leaf())
+                {
+                    if (test_leaf(node.first, node.first + node.count))
+                        return true;
+                }
+                else
+                {
+                    float entry_left, entry_right;
+                    const bool hit_left = _nodes[node.first].bounds.intersect(origin, inv_direction, max_distance, &entry_left);
+                    const bool hit_right = _nodes[node.first + 1].bounds.intersect(origin, inv_direction, max_distance, &entry_right);
+
+                    // the nearer child is still visited first, as occluders close to the ray origin tend to be found sooner there
+                    if (hit_left && hit_right)
+                    {
+                        const bool left_first = entry_left <= entry_right;
+
+                        stack[stack_size++] = left_first ? node.first + 1 : node.first;
+                        node_index = left_first ? node.first : node.first + 1;
+
+                        continue;
+                    }
+                    else if (hit_left || hit_right)
+                    {
+                        node_index = hit_left ? node.first : node.first + 1;
+
+                        continue;
+                    }
+                }
+
+                if (!stack_size)
+                    return false;
+
+                node_index = stack[--stack_size];
+            }
+        }
+
+        TO_STRING(bvh, "Nodes=" << _nodes.size() << ",Primitives=" << _indices.size());
+    };
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "ray3.hpp"
+
+
+namespace ray_tracer_3d
+{
+    struct camera_configuration
+    {
+        vec3 position;
+        vec3 look_at;
+        float zoom_factor;
+        float focal_length;
+    };
+
+    // Pinhole camera prepared once per frame from a 'camera_configuration'. It holds the gaze direction and the two image plane axes already scaled by the
+    // field of view and the aspect ratio, so that the direction through an image plane point (x, y) in [-1, 1] is 'gaze + x * horizontal + y * vertical'.
+    struct camera
+    {
+        float position[3];
+        float gaze[3];
+        float horizontal[3];
+        float vertical[3];
+        float focal_length;
+
+
+        camera(const camera_configuration& config, const float width, const float height) noexcept
+            : focal_length(config.focal_length)
+        {
+            const float fov = M_PI_2 / config.zoom_factor;
+            const vec3 g = config.look_at.sub(config.position).normalize();
+            const vec3 h = g.cross(vec3::UnitY).normalize().scale(width * fov / height);
+            const vec3 v = h.cross(g).normalize().scale(fov);
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                position[axis] = config.position[axis];
+                gaze[axis] = g[axis];
+                horizontal[axis] = h[axis];
+                vertical[axis] = v[axis];
+            }
+        }
+
+        // Returns the normalized direction through the image plane point (x, y).
+        inline vec3 direction(const float x, const float y) const noexcept
+        {
+            float dx, dy, dz;
+
+            directions(&x, &y, 1, &dx, &dy, &dz);
+
+            return vec3(dx, dy, dz);
+        }
+
+        // Computes the normalized directions through 'count' image plane points at once. The loop has no dependencies between points and is written over
+        // plain float streams, so that the compiler vectorizes it. Single directions go through the same code and are therefore identical to batched ones.
+        inline void directions(
+            const float* const __restrict x,
+            const float* const __restrict y,
+            const size_t count,
+            float* const __restrict dx,
+            float* const __restrict dy,
+            float* const __restrict dz
+        ) const noexcept
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                const float px = gaze[0] + horizontal[0] * x[i] + vertical[0] * y[i];
+                const float py = gaze[1] + horizontal[1] * x[i] + vertical[1] * y[i];
+                const float pz = gaze[2] + horizontal[2] * x[i] + vertical[2] * y[i];
+                const float inv_length = 1.f / std::sqrt(px * px + py * py + pz * pz);
+
+                dx[i] = px * inv_length;
+                dy[i] = py * inv_length;
+                dz[i] = pz * inv_length;
+            }
+        }
+
+        // Creates the primary ray for the given normalized direction. It starts on the focal plane instead of the camera position.
+        inline ray3 create_ray(const vec3& direction, const float refraction_index) const noexcept
+        {
+            const vec3 origin(
+                position[0] + direction.X * focal_length,
+                position[1] + direction.Y * focal_length,
+                position[2] + direction.Z * focal_length
+            );
+
+            return ray3(origin, direction, 0, refraction_index, false);
+        }
+
+        TO_STRING(camera, "P=" << vec3(position[0], position[1], position[2])
+                      << ",G=" << vec3(gaze[0], gaze[1], gaze[2])
+                      << ",H=" << vec3(horizontal[0], horizontal[1], horizontal[2])
+                      << ",V=" << vec3(vertical[0], vertical[1], vertical[2]));
+    };
+};
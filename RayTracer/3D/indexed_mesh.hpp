@@ -0,0 +1,172 @@
+#pragma once
+
+#include "primitive3.hpp"
+
+
+namespace ray_tracer_3d
+{
+    // Triangle mesh stored as packed arrays of shared vertices, vertex indices and per-triangle material indices, instead of one heap-allocated
+    // 'triangle' per face. The material indices refer to the mesh's own table, which is placed in the scene's material table at 'first_material'. The
+    // arrays are not owned by the mesh itself but kept alive through 'storage', which is either a memory-mapped scene file whose sections are used in
+    // place, or the vectors the mesh has been assembled in. Indexed meshes are therefore cheap to copy and never modified.
+    struct indexed_mesh
+    {
+        // three coordinates per vertex
+        const float* positions = nullptr;
+        // optional (i.e. null if absent) three normal components per vertex. zero normals fall back to the face normal.
+        const float* normals = nullptr;
+        // optional two texture coordinates per vertex
+        const float* uvs = nullptr;
+        // three vertex indices per triangle
+        const uint* indices = nullptr;
+        // one index into 'materials' per triangle
+        const uint* material_indices = nullptr;
+        // the mesh's own material table, which is copied into the scene's table when the mesh is added (see 'scene::add_indexed_mesh')
+        const material* materials = nullptr;
+        size_t vertex_count = 0;
+        size_t triangle_count = 0;
+        size_t material_count = 0;
+        // index of the mesh's first material within the scene's material table
+        uint first_material = 0;
+        std::shared_ptr<const void> storage;
+
+
+        inline vec3 vertex(const size_t index) const noexcept
+        {
+            return vec3(positions[3 * index], positions[3 * index + 1], positions[3 * index + 2]);
+        }
+
+        inline void triangle_vertices(const size_t triangle, vec3* const __restrict a, vec3* const __restrict b, vec3* const __restrict c) const noexcept
+        {
+            *a = vertex(indices[3 * triangle]);
+            *b = vertex(indices[3 * triangle + 1]);
+            *c = vertex(indices[3 * triangle + 2]);
+        }
+
+        // Returns the index of the triangle's material within the scene's material table.
+        inline uint material_index_of(const size_t triangle) const noexcept
+        {
+            return first_material + material_indices[triangle];
+        }
+
+        // Returns the same non-normalized face normal as 'triangle::normal_at'.
+        inline vec3 normal_of(const size_t triangle) const noexcept
+        {
+            vec3 a, b, c;
+
+            triangle_vertices(triangle, &a, &b, &c);
+
+            return b.sub(a).cross(c.sub(a));
+        }
+
+        // Returns the normalized vertex normal interpolated at the given barycentric coordinates (as reported by the Möller-Trumbore test, i.e. the
+        // weights of the second and third vertex), or the face normal if the mesh has no vertex normals.
+        inline vec3 normal_at(const size_t triangle, const vec2& barycentric) const noexcept
+        {
+            if (!normals)
+                return normal_of(triangle);
+
+            const uint* const corners = indices + 3 * triangle;
+            const float weights[3] = { 1 - barycentric.X - barycentric.Y, barycentric.X, barycentric.Y };
+            float normal[3] = { 0, 0, 0 };
+
+            for (int corner = 0; corner < 3; ++corner)
+                for (int axis = 0; axis < 3; ++axis)
+                    normal[axis] += normals[3 * corners[corner] + axis] * weights[corner];
+
+            const vec3 interpolated(normal[0], normal[1], normal[2]);
+            const float length = interpolated.length();
+
+            return length > 0 ? interpolated / length : normal_of(triangle);
+        }
+
+        // Returns the texture coordinates interpolated at the given barycentric coordinates, or the barycentric coordinates themselves if the mesh has no UVs.
+        inline vec2 uv_at(const size_t triangle, const vec2& barycentric) const noexcept
+        {
+            if (!uvs)
+                return barycentric;
+
+            const uint* const corners = indices + 3 * triangle;
+            const float weights[3] = { 1 - barycentric.X - barycentric.Y, barycentric.X, barycentric.Y };
+            float uv[2] = { 0, 0 };
+
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                uv[0] += uvs[2 * corners[corner]] * weights[corner];
+                uv[1] += uvs[2 * corners[corner] + 1] * weights[corner];
+            }
+
+            return vec2(uv[0], uv[1]);
+        }
+
+        inline aabb bounding_box(const size_t triangle) const noexcept
+        {
+            vec3 a, b, c;
+
+            triangle_vertices(triangle, &a, &b, &c);
+
+            aabb box(a, b);
+
+            box.extend(c);
+
+            return box;
+        }
+
+        TO_STRING(indexed_mesh, "Vertices=" << vertex_count << ",Triangles=" << triangle_count << ",Materials=" << material_count
+                             << ",Normals=" << (normals != nullptr) << ",UVs=" << (uvs != nullptr));
+    };
+
+    // Arrays of an indexed mesh assembled in memory, e.g. while a file is parsed. Empty normal or UV arrays leave the mesh without them.
+    struct mesh_arrays
+    {
+        std::vector<float> positions;
+        std::vector<float> normals;
+        std::vector<float> uvs;
+        std::vector<uint> indices;
+        std::vector<uint> material_indices;
+        std::vector<material> materials;
+
+
+        // Returns an indexed mesh over the given arrays, which it keeps alive.
+        static inline indexed_mesh to_mesh(const std::shared_ptr<const mesh_arrays>& arrays) noexcept
+        {
+            indexed_mesh mesh;
+
+            mesh.positions = arrays->positions.data();
+            mesh.normals = arrays->normals.empty() ? nullptr : arrays->normals.data();
+            mesh.uvs = arrays->uvs.empty() ? nullptr : arrays->uvs.data();
+            mesh.indices = arrays->indices.data();
+            mesh.material_indices = arrays->material_indices.data();
+            mesh.materials = arrays->materials.data();
+            mesh.vertex_count = arrays->positions.size() / 3;
+            mesh.triangle_count = arrays->material_indices.size();
+            mesh.material_count = arrays->materials.size();
+            mesh.storage = arrays;
+
+            return mesh;
+        }
+    };
+
+    // Returns the index of every mesh's first triangle within the consecutively numbered triangles of all meshes, followed by the total triangle count.
+    inline std::vector<size_t> triangle_offsets(const std::vector<indexed_mesh>& meshes)
+    {
+        std::vector<size_t> offsets(1, 0);
+
+        for (const indexed_mesh& mesh : meshes)
+            offsets.push_back(offsets.back() + mesh.triangle_count);
+
+        return offsets;
+    }
+
+    // Finds the mesh of a triangle given by its index into the consecutively numbered triangles of all meshes, through a binary search of the meshes'
+    // offsets (see 'triangle_offsets'). 'triangle' receives the index within the returned mesh. The index must be smaller than the total triangle count.
+    inline const indexed_mesh& locate_triangle(const std::vector<indexed_mesh>& meshes, const std::vector<size_t>& offsets, const size_t index, size_t* const triangle) noexcept
+    {
+        // the last mesh which starts at or before the index. empty meshes start where their successor does and are skipped this way.
+        const size_t mesh = std::upper_bound(offsets.begin(), offsets.end() - 1, index) - offsets.begin() - 1;
+
+        *triangle = index - offsets[mesh];
+
+        return meshes[mesh];
+    }
+};
@@ -0,0 +1,935 @@
+#include "mesh_importer.hpp"
+#include "../mapped_file.hpp"
+#include "../task_pool.hpp"
+
+#include <bit>
+#include <charconv>
+#include <unordered_map>
+
+using namespace ray_tracer_3d;
+
+
+// OBJ files are split into chunks of about this many bytes, which are counted and parsed in parallel
+static constexpr size_t OBJ_CHUNK_SIZE = 1 << 20;
+// PLY faces are decoded in parallel blocks of this many faces
+static constexpr size_t PLY_BLOCK_SIZE = 1 << 16;
+// marks absent texture coordinate and normal indices of OBJ corners
+static constexpr uint ABSENT = ~0u;
+
+static bool fail(std::string* const error, const std::string& message) noexcept
+{
+    if (error)
+        *error = message;
+
+    return false;
+}
+
+// Computes area-weighted normals of the given positions from the faces which reference them. The faces are accumulated serially, as neighbouring faces
+// share their vertices, while the normalization runs in parallel.
+static std::vector<float> compute_normals(const std::vector<float>& positions, const uint* const indices, const size_t triangle_count) noexcept
+{
+    std::vector<float> normals(positions.size(), 0.f);
+    const auto vertex = [&](const uint index)
+    {
+        return vec3(positions[3 * index], positions[3 * index + 1], positions[3 * index + 2]);
+    };
+
+    for (size_t triangle = 0; triangle < triangle_count; ++triangle)
+    {
+        const uint* const corners = indices + 3 * triangle;
+        const vec3 a = vertex(corners[0]);
+        // the cross product's length is twice the face's area, which weights the face accordingly
+        const vec3 normal = vertex(corners[1]).sub(a).cross(vertex(corners[2]).sub(a));
+
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            normals[3 * corners[corner]] += normal.X;
+            normals[3 * corners[corner] + 1] += normal.Y;
+            normals[3 * corners[corner] + 2] += normal.Z;
+        }
+    }
+
+    parallel_for(size_t(0), normals.size() / 3, [&](const size_t index)
+    {
+        float* const normal = normals.data() + 3 * index;
+        const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+        if (length > 0)
+            for (int axis = 0; axis < 3; ++axis)
+                normal[axis] /= length;
+    });
+
+    return normals;
+}
+
+// Completes the imported arrays with the material table and returns the mesh over them.
+static void finish_mesh(const std::shared_ptr<mesh_arrays>& arrays, const material& mat, indexed_mesh* const mesh) noexcept
+{
+    arrays->material_indices.assign(arrays->indices.size() / 3, 0);
+    arrays->materials.assign(1, mat);
+
+    *mesh = mesh_arrays::to_mesh(arrays);
+}
+
+static inline const char* skip_spaces(const char* position, const char* const end) noexcept
+{
+    while (position < end && (*position == ' ' || *position == '\t' || *position == '\r'))
+        ++position;
+
+    return position;
+}
+
+// Returns the next token of the line and advances 'position' behind it. The token is empty at the end of the line.
+static inline std::string_view next_token(const char*& position, const char* const end) noexcept
+{
+    const char* const begin = skip_spaces(position, end);
+
+    position = begin;
+
+    while (position < end && *position != ' ' && *position != '\t' && *position != '\r')
+        ++position;
+
+    return std::string_view(begin, position - begin);
+}
+
+template<typename T>
+static inline bool parse_number(const std::string_view token, T* const value) noexcept
+{
+    const auto [end, status] = std::from_chars(token.data(), token.data() + token.size(), *value);
+
+    return !token.empty() && status == std::errc() && end == token.data() + token.size();
+}
+
+// Calls 'func(begin, end)' for every line in [begin, end), excluding its line break and any comment.
+template<typename F>
+static void for_each_line(const char* begin, const char* const end, const F& func)
+{
+    while (begin < end)
+    {
+        const char* line_end = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+
+        if (!line_end)
+            line_end = end;
+
+        func(begin, std::find(begin, line_end, '#'));
+        begin = line_end + 1;
+    }
+}
+
+// Chunk of whole lines of an OBJ file. The first pass counts the chunk's elements, whose prefix sums then give every chunk the place of its first
+// element in the mesh's arrays, into which the second pass parses them.
+struct obj_chunk
+{
+    const char* begin;
+    const char* end;
+    size_t lines = 0;
+    size_t positions = 0;
+    size_t texcoords = 0;
+    size_t normals = 0;
+    size_t triangles = 0;
+    size_t first_line = 0;
+    size_t first_position = 0;
+    size_t first_texcoord = 0;
+    size_t first_normal = 0;
+    size_t first_triangle = 0;
+    bool uses_texcoords = false;
+    bool uses_normals = false;
+    std::string error;
+};
+
+// Corner of an OBJ face, which becomes a vertex of its own if its texture coordinates or its normal differ from those of the position's first corner
+struct obj_corner
+{
+    uint position;
+    uint texcoord;
+    uint normal;
+
+
+    inline bool operator==(const obj_corner& other) const noexcept
+    {
+        return position == other.position && texcoord == other.texcoord && normal == other.normal;
+    }
+};
+
+struct obj_corner_hash
+{
+    inline size_t operator()(const obj_corner& corner) const noexcept
+    {
+        return (size_t(corner.position) * 0x9e3779b97f4a7c15ull) ^ (size_t(corner.texcoord) * 0xc2b2ae3d27d4eb4full) ^ corner.normal;
+    }
+};
+
+// Parses the OBJ index of a 'v/vt/vn' corner part, which is one-based or relative to the given number of elements declared so far if negative.
+// Returns false for invalid indices and leaves ABSENT for empty parts.
+static inline bool parse_obj_index(const std::string_view part, const size_t declared, const size_t total, uint* const index) noexcept
+{
+    long long value;
+
+    *index = ABSENT;
+
+    if (part.empty())
+        return true;
+    else if (!parse_number(part, &value) || !value)
+        return false;
+
+    value = value > 0 ? value - 1 : value + (long long)declared;
+
+    if (value < 0 || size_t(value) >= total)
+        return false;
+
+    *index = uint(value);
+
+    return true;
+}
+
+static void parse_obj_chunk(obj_chunk& chunk, const size_t total_positions, const size_t total_texcoords, const size_t total_normals, float* const positions, float* const texcoords, float* const normals, obj_corner* const corners) noexcept
+{
+    size_t line = chunk.first_line;
+    size_t position = chunk.first_position;
+    size_t texcoord = chunk.first_texcoord;
+    size_t normal = chunk.first_normal;
+    obj_corner* corner = corners + 3 * chunk.first_triangle;
+    obj_corner first, previous;
+
+    const auto fail = [&](const std::string& message)
+    {
+        chunk.error = "line " + std::to_string(line) + ": " + message;
+    };
+
+    for_each_line(chunk.begin, chunk.end, [&](const char* begin, const char* const end)
+    {
+        ++line;
+
+        if (!chunk.error.empty())
+            return;
+
+        const std::string_view keyword = next_token(begin, end);
+
+        if (keyword == "v" || keyword == "vn")
+        {
+            float* const target = keyword == "v" ? positions + 3 * position++ : normals + 3 * normal++;
+
+            // further values (e.g. vertex colors) are ignored
+            if (!parse_number(next_token(begin, end), target) || !parse_number(next_token(begin, end), target + 1) || !parse_number(next_token(begin, end), target + 2))
+                fail("expected three coordinates");
+        }
+        else if (keyword == "vt")
+        {
+            float* const target = texcoords + 2 * texcoord++;
+            const std::string_view v = (parse_number(next_token(begin, end), target), next_token(begin, end));
+
+            target[1] = 0;
+
+            if (!v.empty() && !parse_number(v, target + 1))
+                fail("invalid texture coordinate");
+        }
+        else if (keyword == "f")
+        {
+            int count = 0;
+
+            for (std::string_view token = next_token(begin, end); !token.empty() && chunk.error.empty(); token = next_token(begin, end), ++count)
+            {
+                const size_t first_slash = std::min(token.find('/'), token.size());
+                const size_t second_slash = std::min(token.find('/', first_slash + 1), token.size());
+                obj_corner current;
+
+                if (!parse_obj_index(token.substr(0, first_slash), position, total_positions, &current.position) || current.position == ABSENT ||
+                    !parse_obj_index(token.substr(std::min(first_slash + 1, token.size()), second_slash - std::min(first_slash + 1, token.size())), texcoord, total_texcoords, &current.texcoord) ||
+                    !parse_obj_index(token.substr(std::min(second_slash + 1, token.size())), normal, total_normals, &current.normal))
+                {
+                    fail("invalid face corner '" + std::string(token) + "'");
+
+                    break;
+                }
+
+                chunk.uses_texcoords |= current.texcoord != ABSENT;
+                chunk.uses_normals |= current.normal != ABSENT;
+
+                // polygons are split into a fan around their first corner
+                if (count >= 2)
+                {
+                    *corner++ = first;
+                    *corner++ = previous;
+                    *corner++ = current;
+                }
+                else if (!count)
+                    first = current;
+
+                previous = current;
+            }
+        }
+    });
+}
+
+bool ray_tracer_3d::import_obj(const char* const path, const material& mat, indexed_mesh* const mesh, std::string* const error) noexcept
+{
+    const std::shared_ptr<mapped_file> file = mapped_file::open(path);
+
+    if (!file)
+        return fail(error, "unable to open '" + std::string(path) + "'");
+
+    const char* const data = file->data();
+    const size_t chunk_count = std::max<size_t>(1, file->size() / OBJ_CHUNK_SIZE);
+    std::vector<obj_chunk> chunks(chunk_count);
+
+    // chunks are extended to the next line break, so that every line belongs to exactly one of them
+    for (size_t i = 0; i < chunk_count; ++i)
+    {
+        const char* end = data + file->size() * (i + 1) / chunk_count;
+
+        while (end < data + file->size() && end[-1] != '\n')
+            ++end;
+
+        chunks[i].begin = i ? chunks[i - 1].end : data;
+        chunks[i].end = std::max(end, chunks[i].begin);
+    }
+
+    parallel_for(size_t(0), chunk_count, [&](const size_t i)
+    {
+        obj_chunk& chunk = chunks[i];
+
+        for_each_line(chunk.begin, chunk.end, [&](const char* begin, const char* const end)
+        {
+            const std::string_view keyword = next_token(begin, end);
+
+            ++chunk.lines;
+
+            if (keyword == "v")
+                ++chunk.positions;
+            else if (keyword == "vt")
+                ++chunk.texcoords;
+            else if (keyword == "vn")
+                ++chunk.normals;
+            else if (keyword == "f")
+            {
+                size_t count = 0;
+
+                while (!next_token(begin, end).empty())
+                    ++count;
+
+                chunk.triangles += count >= 3 ? count - 2 : 0;
+            }
+        });
+    }, 1);
+
+    for (size_t i = 1; i < chunk_count; ++i)
+    {
+        chunks[i].first_line = chunks[i - 1].first_line + chunks[i - 1].lines;
+        chunks[i].first_position = chunks[i - 1].first_position + chunks[i - 1].positions;
+        chunks[i].first_texcoord = chunks[i - 1].first_texcoord + chunks[i - 1].texcoords;
+        chunks[i].first_normal = chunks[i - 1].first_normal + chunks[i - 1].normals;
+        chunks[i].first_triangle = chunks[i - 1].first_triangle + chunks[i - 1].triangles;
+    }
+
+    const obj_chunk& last = chunks.back();
+    const size_t position_count = last.first_position + last.positions;
+    const size_t texcoord_count = last.first_texcoord + last.texcoords;
+    const size_t normal_count = last.first_normal + last.normals;
+    const size_t triangle_count = last.first_triangle + last.triangles;
+
+    // vertices and corners are indexed through 32 bit integers
+    if (3 * triangle_count >= ABSENT || position_count >= ABSENT)
+        return fail(error, "too many faces or vertices");
+
+    const std::shared_ptr<mesh_arrays> arrays = std::make_shared<mesh_arrays>();
+    std::vector<float> texcoords(2 * texcoord_count);
+    std::vector<float> normals(3 * normal_count);
+    std::vector<obj_corner> corners(3 * triangle_count);
+
+    arrays->positions.resize(3 * position_count);
+
+    parallel_for(size_t(0), chunk_count, [&](const size_t i)
+    {
+        parse_obj_chunk(chunks[i], position_count, texcoord_count, normal_count, arrays->positions.data(), texcoords.data(), normals.data(), corners.data());
+    }, 1);
+
+    bool uses_texcoords = false;
+    bool uses_normals = false;
+
+    for (const obj_chunk& chunk : chunks)
+        if (!chunk.error.empty())
+            return fail(error, chunk.error);
+        else
+        {
+            uses_texcoords |= chunk.uses_texcoords;
+            uses_normals |= chunk.uses_normals;
+        }
+
+    const size_t corner_count = corners.size();
+
+    arrays->indices.resize(corner_count);
+
+    if (!uses_texcoords && !uses_normals)
+    {
+        // the positions are the vertices
+        parallel_for(size_t(0), corner_count, [&](const size_t corner)
+        {
+            arrays->indices[corner] = corners[corner].position;
+        });
+
+        arrays->normals = compute_normals(arrays->positions, arrays->indices.data(), triangle_count);
+        finish_mesh(arrays, mat, mesh);
+
+        return true;
+    }
+
+    // every position becomes the vertex of its first corner in file order. the other corners share it if they have the same texture coordinates and
+    // normal, and otherwise receive vertices of their own, which are appended in file order. this keeps the result independent of the thread timing.
+    std::vector<std::atomic<uint>> first_corner(position_count);
+    std::vector<uint> split_corners;
+    std::unordered_map<obj_corner, uint, obj_corner_hash> split_vertices;
+
+    parallel_for(size_t(0), position_count, [&](const size_t position)
+    {
+        first_corner[position].store(ABSENT, std::memory_order_relaxed);
+    });
+    parallel_for(size_t(0), corner_count, [&](const size_t corner)
+    {
+        std::atomic<uint>& first = first_corner[corners[corner].position];
+        uint current = first.load(std::memory_order_relaxed);
+
+        while (corner < current && !first.compare_exchange_weak(current, uint(corner), std::memory_order_relaxed))
+            ;
+    });
+    parallel_for(size_t(0), corner_count, [&](const size_t corner)
+    {
+        const uint position = corners[corner].position;
+
+        arrays->indices[corner] = corners[first_corner[position].load(std::memory_order_relaxed)] == corners[corner] ? position : ABSENT;
+    });
+
+    for (size_t corner = 0; corner < corner_count; ++corner)
+        if (arrays->indices[corner] == ABSENT)
+        {
+            const auto [match, inserted] = split_vertices.try_emplace(corners[corner], uint(position_count + split_corners.size()));
+
+            if (inserted)
+                split_corners.push_back(corner);
+
+            arrays->indices[corner] = match->second;
+        }
+
+    const size_t vertex_count = position_count + split_corners.size();
+    // returns the corner whose attributes the vertex receives, or ABSENT for unreferenced positions
+    const auto source_corner = [&](const size_t vertex) -> uint
+    {
+        return vertex < position_count ? first_corner[vertex].load(std::memory_order_relaxed) : split_corners[vertex - position_count];
+    };
+
+    arrays->positions.resize(3 * vertex_count);
+
+    if (uses_texcoords)
+        arrays->uvs.resize(2 * vertex_count);
+
+    std::vector<float> position_normals;
+
+    if (uses_normals)
+        arrays->normals.resize(3 * vertex_count);
+    else
+    {
+        // normals are computed per position, so that vertices split at texture seams still share their normal
+        std::vector<uint> position_indices(corner_count);
+
+        parallel_for(size_t(0), corner_count, [&](const size_t corner)
+        {
+            position_indices[corner] = corners[corner].position;
+        });
+
+        position_normals = compute_normals(std::vector<float>(arrays->positions.begin(), arrays->positions.begin() + 3 * position_count), position_indices.data(), triangle_count);
+        arrays->normals.resize(3 * vertex_count);
+    }
+
+    parallel_for(size_t(0), vertex_count, [&](const size_t vertex)
+    {
+        const uint corner = source_corner(vertex);
+
+        if (corner == ABSENT)
+            return;
+
+        const obj_corner& source = corners[corner];
+
+        if (vertex >= position_count)
+            for (int axis = 0; axis < 3; ++axis)
+                arrays->positions[3 * vertex + axis] = arrays->positions[3 * source.position + axis];
+
+        if (uses_texcoords && source.texcoord != ABSENT)
+        {
+            arrays->uvs[2 * vertex] = texcoords[2 * source.texcoord];
+            arrays->uvs[2 * vertex + 1] = texcoords[2 * source.texcoord + 1];
+        }
+
+        // corners without a normal keep a zero normal, which makes them fall back to the face normal
+        if (!uses_normals)
+            for (int axis = 0; axis < 3; ++axis)
+                arrays->normals[3 * vertex + axis] = position_normals[3 * source.position + axis];
+        else if (source.normal != ABSENT)
+            for (int axis = 0; axis < 3; ++axis)
+                arrays->normals[3 * vertex + axis] = normals[3 * source.normal + axis];
+    });
+
+    finish_mesh(arrays, mat, mesh);
+
+    return true;
+}
+
+enum class ply_type
+{
+    invalid,
+    int8,
+    uint8,
+    int16,
+    uint16,
+    int32,
+    uint32,
+    float32,
+    float64,
+};
+
+struct ply_property
+{
+    std::string name;
+    ply_type type;
+    // type of the element count of list properties, 'invalid' for scalar properties
+    ply_type count_type = ply_type::invalid;
+};
+
+struct ply_element
+{
+    std::string name;
+    size_t count;
+    std::vector<ply_property> properties;
+};
+
+static ply_type ply_type_of(const std::string_view name) noexcept
+{
+    if (name == "char" || name == "int8")
+        return ply_type::int8;
+    else if (name == "uchar" || name == "uint8")
+        return ply_type::uint8;
+    else if (name == "short" || name == "int16")
+        return ply_type::int16;
+    else if (name == "ushort" || name == "uint16")
+        return ply_type::uint16;
+    else if (name == "int" || name == "int32")
+        return ply_type::int32;
+    else if (name == "uint" || name == "uint32")
+        return ply_type::uint32;
+    else if (name == "float" || name == "float32")
+        return ply_type::float32;
+    else if (name == "double" || name == "float64")
+        return ply_type::float64;
+    else
+        return ply_type::invalid;
+}
+
+static inline size_t size_of(const ply_type type) noexcept
+{
+    switch (type)
+    {
+        case ply_type::int8:
+        case ply_type::uint8:
+            return 1;
+        case ply_type::int16:
+        case ply_type::uint16:
+            return 2;
+        case ply_type::int32:
+        case ply_type::uint32:
+        case ply_type::float32:
+            return 4;
+        case ply_type::float64:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+// Reads a value of the given type, whose bytes are reversed first if the file's byte order differs from the machine's.
+static inline double read_value(const char* const data, const ply_type type, const bool swap) noexcept
+{
+    char bytes[8];
+    const size_t size = size_of(type);
+
+    std::memcpy(bytes, data, size);
+
+    if (swap)
+        std::reverse(bytes, bytes + size);
+
+    const auto as = [&](auto value)
+    {
+        std::memcpy(&value, bytes, sizeof(value));
+
+        return double(value);
+    };
+
+    switch (type)
+    {
+        case ply_type::int8:
+            return as(int8_t());
+        case ply_type::uint8:
+            return as(uint8_t());
+        case ply_type::int16:
+            return as(int16_t());
+        case ply_type::uint16:
+            return as(uint16_t());
+        case ply_type::int32:
+            return as(int32_t());
+        case ply_type::uint32:
+            return as(uint32_t());
+        case ply_type::float32:
+            return as(float());
+        default:
+            return as(double());
+    }
+}
+
+// Returns the size of the element record at 'data', which is zero if the record exceeds 'end'. 'list_property' selects a list property, whose
+// element count is stored in 'list_count', and whose items start at 'list_offset' bytes into the record.
+static size_t ply_record_size(const ply_element& element, const char* const data, const char* const end, const bool swap, const int list_property = -1, size_t* const list_count = nullptr, size_t* const list_offset = nullptr) noexcept
+{
+    size_t size = 0;
+
+    for (size_t i = 0; i < element.properties.size(); ++i)
+    {
+        const ply_property& property = element.properties[i];
+
+        if (property.count_type == ply_type::invalid)
+            size += size_of(property.type);
+        else
+        {
+            const size_t count_size = size_of(property.count_type);
+
+            if (size_t(end - data) < size + count_size)
+                return 0;
+
+            const double count = read_value(data + size, property.count_type, swap);
+
+            if (!(count >= 0))
+                return 0;
+
+            size += count_size;
+
+            if (int(i) == list_property)
+            {
+                *list_count = size_t(count);
+                *list_offset = size;
+            }
+
+            size += size_t(count) * size_of(property.type);
+        }
+
+        if (size_t(end - data) < size)
+            return 0;
+    }
+
+    return size;
+}
+
+bool ray_tracer_3d::import_ply(const char* const path, const material& mat, indexed_mesh* const mesh, std::string* const error) noexcept
+{
+    const std::shared_ptr<mapped_file> file = mapped_file::open(path);
+
+    if (!file)
+        return fail(error, "unable to open '" + std::string(path) + "'");
+
+    const char* position = file->data();
+    const char* const end = file->data() + file->size();
+    std::vector<ply_element> elements;
+    bool swap = false;
+    bool has_format = false;
+
+    // the header consists of text lines up to 'end_header'
+    for (size_t line = 1; ; ++line)
+    {
+        const char* line_end = static_cast<const char*>(std::memchr(position, '\n', end - position));
+
+        if (!line_end)
+            return fail(error, "missing end of header");
+
+        const char* token_position = position;
+        const std::string_view keyword = next_token(token_position, line_end);
+
+        position = line_end + 1;
+
+        if (line == 1)
+        {
+            if (keyword != "ply")
+                return fail(error, "not a PLY file");
+        }
+        else if (keyword == "format")
+        {
+            const std::string_view format = next_token(token_position, line_end);
+            constexpr bool little_endian = std::endian::native == std::endian::little;
+
+            if (format == "ascii")
+                return fail(error, "ASCII PLY files are not supported");
+            else if (format != "binary_little_endian" && format != "binary_big_endian")
+                return fail(error, "unknown format '" + std::string(format) + "'");
+
+            swap = (format == "binary_little_endian") != little_endian;
+            has_format = true;
+        }
+        else if (keyword == "element")
+        {
+            const std::string_view name = next_token(token_position, line_end);
+            size_t count;
+
+            if (!parse_number(next_token(token_position, line_end), &count))
+                return fail(error, "line " + std::to_string(line) + ": invalid element count");
+
+            elements.push_back({ std::string(name), count, { } });
+        }
+        else if (keyword == "property")
+        {
+            const std::string_view type = next_token(token_position, line_end);
+            ply_property property;
+
+            if (elements.empty())
+                return fail(error, "line " + std::to_string(line) + ": property outside of an element");
+            else if (type == "list")
+            {
+                property.count_type = ply_type_of(next_token(token_position, line_end));
+                property.type = ply_type_of(next_token(token_position, line_end));
+
+                if (property.count_type == ply_type::invalid || property.count_type == ply_type::float32 || property.count_type == ply_type::float64)
+                    return fail(error, "line " + std::to_string(line) + ": invalid list count type");
+            }
+            else
+                property.type = ply_type_of(type);
+
+            property.name = next_token(token_position, line_end);
+
+            if (property.type == ply_type::invalid)
+                return fail(error, "line " + std::to_string(line) + ": unknown property type");
+
+            elements.back().properties.push_back(property);
+        }
+        else if (keyword == "end_header")
+            break;
+        else if (keyword != "comment" && keyword != "obj_info" && !keyword.empty())
+            return fail(error, "line " + std::to_string(line) + ": unknown header keyword '" + std::string(keyword) + "'");
+    }
+
+    if (!has_format)
+        return fail(error, "missing format");
+
+    const std::shared_ptr<mesh_arrays> arrays = std::make_shared<mesh_arrays>();
+    size_t vertex_count = 0;
+    bool has_vertices = false;
+    bool has_faces = false;
+
+    // elements are stored one after another in the order of the header
+    for (const ply_element& element : elements)
+    {
+        const auto find = [&](const std::initializer_list<std::string_view> names)
+        {
+            for (size_t i = 0; i < element.properties.size(); ++i)
+                for (const std::string_view name : names)
+                    if (element.properties[i].name == name)
+                        return int(i);
+
+            return -1;
+        };
+
+        if (element.name == "vertex")
+        {
+            size_t stride = 0;
+            std::vector<size_t> offsets;
+
+            for (const ply_property& property : element.properties)
+            {
+                if (property.count_type != ply_type::invalid)
+                    return fail(error, "list properties of vertices are not supported");
+
+                offsets.push_back(stride);
+                stride += size_of(property.type);
+            }
+
+            const int coordinates[8] = {
+                find({ "x" }), find({ "y" }), find({ "z" }),
+                find({ "nx" }), find({ "ny" }), find({ "nz" }),
+                find({ "u", "s", "texture_u", "texture_s" }), find({ "v", "t", "texture_v", "texture_t" }),
+            };
+            const bool has_normals = coordinates[3] >= 0 && coordinates[4] >= 0 && coordinates[5] >= 0;
+            const bool has_uvs = coordinates[6] >= 0 && coordinates[7] >= 0;
+
+            if (coordinates[0] < 0 || coordinates[1] < 0 || coordinates[2] < 0)
+                return fail(error, "vertices without coordinates");
+            else if (element.count >= ABSENT)
+                return fail(error, "too many vertices");
+            else if (size_t(end - position) / std::max<size_t>(stride, 1) < element.count)
+                return fail(error, "truncated vertex data");
+
+            vertex_count = element.count;
+            arrays->positions.resize(3 * vertex_count);
+
+            if (has_normals)
+                arrays->normals.resize(3 * vertex_count);
+
+            if (has_uvs)
+                arrays->uvs.resize(2 * vertex_count);
+
+            const char* const vertices = position;
+
+            parallel_for(size_t(0), vertex_count, [&](const size_t vertex)
+            {
+                const char* const record = vertices + vertex * stride;
+                const auto read = [&](const int property)
+                {
+                    return float(read_value(record + offsets[property], element.properties[property].type, swap));
+                };
+
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    arrays->positions[3 * vertex + axis] = read(coordinates[axis]);
+
+                    if (has_normals)
+                        arrays->normals[3 * vertex + axis] = read(coordinates[3 + axis]);
+                }
+
+                if (has_uvs)
+                {
+                    arrays->uvs[2 * vertex] = read(coordinates[6]);
+                    arrays->uvs[2 * vertex + 1] = read(coordinates[7]);
+                }
+            });
+
+            position += vertex_count * stride;
+            has_vertices = true;
+        }
+        else if (element.name == "face")
+        {
+            const int indices = find({ "vertex_indices", "vertex_index" });
+
+            if (!has_vertices)
+                return fail(error, "faces before vertices");
+            else if (indices < 0 || element.properties[indices].count_type == ply_type::invalid)
+                return fail(error, "faces without vertex indices");
+
+            // one serial pass over the face sizes yields the start and the first triangle of every block, which are then decoded in parallel
+            std::vector<const char*> block_starts;
+            std::vector<size_t> block_triangles;
+            size_t triangle_count = 0;
+
+            for (size_t face = 0; face < element.count; ++face)
+            {
+                size_t count, offset;
+                const size_t size = ply_record_size(element, position, end, swap, indices, &count, &offset);
+
+                if (!size)
+                    return fail(error, "truncated face data");
+                else if (face % PLY_BLOCK_SIZE == 0)
+                {
+                    block_starts.push_back(position);
+                    block_triangles.push_back(triangle_count);
+                }
+
+                triangle_count += count >= 3 ? count - 2 : 0;
+                position += size;
+            }
+
+            if (3 * triangle_count >= ABSENT)
+                return fail(error, "too many faces");
+
+            const ply_type index_type = element.properties[indices].type;
+            const size_t index_size = size_of(index_type);
+            std::atomic<bool> valid_indices = true;
+
+            arrays->indices.resize(3 * triangle_count);
+
+            parallel_for(size_t(0), block_starts.size(), [&](const size_t block)
+            {
+                const char* record = block_starts[block];
+                uint* corner = arrays->indices.data() + 3 * block_triangles[block];
+
+                for (size_t face = block * PLY_BLOCK_SIZE, last = std::min(element.count, face + PLY_BLOCK_SIZE); face < last; ++face)
+                {
+                    size_t count, offset;
+                    const size_t size = ply_record_size(element, record, end, swap, indices, &count, &offset);
+                    const auto index = [&](const size_t i)
+                    {
+                        const double value = read_value(record + offset + i * index_size, index_type, swap);
+
+                        if (!(value >= 0 && value < vertex_count))
+                        {
+                            valid_indices.store(false, std::memory_order_relaxed);
+
+                            return 0u;
+                        }
+
+                        return uint(value);
+                    };
+
+                    // polygons are split into a fan around their first corner
+                    for (size_t i = 2; i < count; ++i)
+                    {
+                        *corner++ = index(0);
+                        *corner++ = index(i - 1);
+                        *corner++ = index(i);
+                    }
+
+                    record += size;
+                }
+            }, 1);
+
+            if (!valid_indices)
+                return fail(error, "vertex index out of range");
+
+            has_faces = true;
+        }
+        else
+            // other elements are skipped record by record, as they may contain lists
+            for (size_t record = 0; record < element.count; ++record)
+            {
+                const size_t size = ply_record_size(element, position, end, swap);
+
+                if (!size && !element.properties.empty())
+                    return fail(error, "truncated '" + element.name + "' data");
+
+                position += size;
+            }
+
+        // nothing behind the faces is needed
+        if (has_faces)
+            break;
+    }
+
+    if (!has_vertices)
+        return fail(error, "no vertices");
+
+    if (arrays->normals.empty())
+        arrays->normals = compute_normals(arrays->positions, arrays->indices.data(), arrays->indices.size() / 3);
+
+    finish_mesh(arrays, mat, mesh);
+
+    return true;
+}
+
+static bool has_extension(const char* const path, const char* const extension) noexcept
+{
+    const size_t length = std::strlen(path);
+    const size_t extension_length = std::strlen(extension);
+
+    if (length < extension_length)
+        return false;
+
+    for (size_t i = 0; i < extension_length; ++i)
+        if (std::tolower(static_cast<unsigned char>(path[length - extension_length + i])) != extension[i])
+            return false;
+
+    return true;
+}
+
+bool ray_tracer_3d::is_mesh_file(const char* const path) noexcept
+{
+    return has_extension(path, ".obj") || has_extension(path, ".ply");
+}
+
+bool ray_tracer_3d::import_mesh(const char* const path, const material& mat, indexed_mesh* const mesh, std::string* const error) noexcept
+{
+    if (has_extension(path, ".obj"))
+        return import_obj(path, mat, mesh, error);
+    else if (has_extension(path, ".ply"))
+        return import_ply(path, mat, mesh, error);
+    else
+        return fail(error, "unknown mesh format of '" + std::string(path) + "'");
+}
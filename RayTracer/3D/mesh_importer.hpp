@@ -0,0 +1,26 @@
+#pragma once
+
+#include "indexed_mesh.hpp"
+
+
+// Importers of triangle meshes from Wavefront OBJ and binary PLY files. Both parse the memory-mapped file in parallel: OBJ files are split into chunks of
+// whole lines, which are first counted and then parsed into their final place, and PLY faces are split into blocks of faces after one quick pass over
+// their sizes. The result is an indexed mesh with shared vertices, per-vertex normals and (if the file has any) per-vertex texture coordinates.
+namespace ray_tracer_3d
+{
+    // Imports the mesh from the file with the given UTF-8 encoded path, whose type is given by its extension (.obj or .ply). Polygons are split into
+    // triangle fans, and all triangles receive the given material. Vertex normals are computed from the adjacent faces if the file has none.
+    // Returns false if the file cannot be read or is malformed, in which case 'error' (if given) receives a description of the problem.
+    bool import_mesh(const char* const path, const material& mat, indexed_mesh* const mesh, std::string* const error = nullptr) noexcept;
+
+    // Imports a Wavefront OBJ file as described for 'import_mesh'. Corners which share a position but differ in their texture coordinates or normals
+    // become separate vertices. Materials, groups and curved surfaces are ignored.
+    bool import_obj(const char* const path, const material& mat, indexed_mesh* const mesh, std::string* const error = nullptr) noexcept;
+
+    // Imports a binary PLY file (of either byte order) as described for 'import_mesh'. The vertex element must provide the properties x, y and z and
+    // may provide nx, ny and nz as well as u and v (or s and t). The face element must provide the list 'vertex_indices' (or 'vertex_index').
+    bool import_ply(const char* const path, const material& mat, indexed_mesh* const mesh, std::string* const error = nullptr) noexcept;
+
+    // Returns whether the path has the extension of a mesh file that 'import_mesh' can read.
+    bool is_mesh_file(const char* const path) noexcept;
+};
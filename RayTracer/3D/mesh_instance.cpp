@@ -0,0 +1,108 @@
+#include "mesh_instance.hpp"
+#include "../task_pool.hpp"
+
+using namespace ray_tracer_3d;
+
+
+// meshes of up to this many triangles are intersected by brute force, as in 'scene::BRUTE_FORCE_THRESHOLD'
+static constexpr size_t BRUTE_FORCE_THRESHOLD = 32;
+// assets consist of indexed triangles only
+static const std::vector<primitive*> NO_PRIMITIVES;
+
+ray_tracer_3d::mesh_asset::mesh_asset(const indexed_mesh& mesh) noexcept
+    : mesh(mesh)
+{
+    const std::vector<indexed_mesh> meshes{ mesh };
+
+    if (mesh.triangle_count <= BRUTE_FORCE_THRESHOLD)
+        triangles.build(NO_PRIMITIVES, meshes);
+    else
+    {
+        std::vector<aabb> triangle_bounds(mesh.triangle_count);
+
+        parallel_for(size_t(0), mesh.triangle_count, [&](const size_t triangle)
+        {
+            triangle_bounds[triangle] = mesh.bounding_box(triangle);
+        });
+
+        acceleration_structure.build(triangle_bounds);
+        triangles.build(NO_PRIMITIVES, meshes, acceleration_structure.primitive_indices());
+    }
+
+    for (size_t vertex = 0; vertex < mesh.vertex_count; ++vertex)
+        bounds.extend(mesh.vertex(vertex));
+}
+
+bool ray_tracer_3d::mesh_asset::intersect(const ray3& ray, hit_test* const result) const noexcept
+{
+    primitive* hit_primitive;
+
+    if (acceleration_structure.is_empty())
+        return triangles.intersect(NO_PRIMITIVES, 0, triangles.size(), ray, result, &hit_primitive);
+    else
+        return acceleration_structure.intersect(NO_PRIMITIVES, triangles, ray, result, &hit_primitive);
+}
+
+bool ray_tracer_3d::mesh_asset::occluded(const ray3& ray, const float max_distance) const noexcept
+{
+    if (acceleration_structure.is_empty())
+        return triangles.occluded(NO_PRIMITIVES, 0, triangles.size(), ray, max_distance);
+    else
+        return acceleration_structure.occluded(NO_PRIMITIVES, triangles, ray, max_distance);
+}
+
+ray_tracer_3d::mesh_instance::mesh_instance(const mesh_asset* const asset, const affine_transform& object_to_world, const uint material_override) noexcept
+    : asset(asset)
+    , object_to_world(object_to_world)
+    , material_override(material_override)
+{
+    object_to_world.invert(&world_to_object);
+}
+
+aabb ray_tracer_3d::mesh_instance::bounding_box() const noexcept
+{
+    const aabb& bounds = asset->bounds;
+    aabb box;
+
+    if (bounds.is_empty())
+        return box;
+
+    for (int corner = 0; corner < 8; ++corner)
+        box.extend(object_to_world.transform_point(vec3(
+            corner & 1 ? bounds.max[0] : bounds.min[0],
+            corner & 2 ? bounds.max[1] : bounds.min[1],
+            corner & 4 ? bounds.max[2] : bounds.min[2]
+        )));
+
+    return box;
+}
+
+bool ray_tracer_3d::mesh_instance::intersect(const ray3& ray, hit_test* const result) const noexcept
+{
+    const vec3 direction = world_to_object.transform_direction(ray.direction);
+    // the object-space ray is normalized again, which scales its distances by the length of the transformed direction
+    const float scale = direction.length();
+    hit_test hit = hit_test();
+
+    hit.distance = result->distance * scale;
+
+    if (!asset->intersect(ray3(world_to_object.transform_point(ray.origin), direction), &hit) || hit.distance / scale >= result->distance)
+        return false;
+
+    *result = hit;
+    result->distance = hit.distance / scale;
+
+    return true;
+}
+
+bool ray_tracer_3d::mesh_instance::occluded(const ray3& ray, const float max_distance) const noexcept
+{
+    const vec3 direction = world_to_object.transform_direction(ray.direction);
+
+    return asset->occluded(ray3(world_to_object.transform_point(ray.origin), direction), max_distance * direction.length());
+}
+
+vec3 ray_tracer_3d::mesh_instance::normal_at(const hit_test& hit) const noexcept
+{
+    return world_to_object.transform_normal(asset->mesh.normal_at(hit.primitive_index, hit.uv)).normalize();
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "affine_transform.hpp"
+#include "bvh.hpp"
+
+
+namespace ray_tracer_3d
+{
+    // Geometry shared by any number of mesh instances: an indexed mesh in object space together with its own acceleration structure, which is built
+    // once when the asset is created. Assets belong to the scene that created them (see 'scene::add_mesh_asset'), whose material table holds their materials.
+    struct mesh_asset
+    {
+        const indexed_mesh mesh;
+        bvh acceleration_structure;
+        triangle_store triangles;
+        // bounding box of the whole mesh in object space
+        aabb bounds;
+
+
+        explicit mesh_asset(const indexed_mesh& mesh) noexcept;
+
+        // Closest-hit test in object space. The hit's primitive index is the index of the triangle within the asset's mesh.
+        bool intersect(const ray3& ray, hit_test* const result) const noexcept;
+
+        bool occluded(const ray3& ray, const float max_distance) const noexcept;
+
+        TO_STRING(mesh_asset, mesh << ",BVH=" << acceleration_structure);
+    };
+
+    // Placement of a mesh asset in the scene through an affine transform, optionally with a material of its own. Rays are transformed into the asset's
+    // object space at the instance boundary, so that all instances share the asset's geometry and acceleration structure.
+    struct mesh_instance
+    {
+        static constexpr uint NO_MATERIAL_OVERRIDE = ~0u;
+
+        const mesh_asset* asset;
+        affine_transform object_to_world;
+        affine_transform world_to_object;
+        // index into the scene's material table replacing the asset's materials, or NO_MATERIAL_OVERRIDE
+        uint material_override;
+
+
+        // The transform must be invertible.
+        mesh_instance(const mesh_asset* const asset, const affine_transform& object_to_world, const uint material_override = NO_MATERIAL_OVERRIDE) noexcept;
+
+        // Returns the world-space bounding box of the transformed asset.
+        aabb bounding_box() const noexcept;
+
+        // Closest-hit test against the transformed asset. The hit's distance is measured in world space, and its primitive index is the index of the
+        // triangle within the asset's mesh. The instance's own index is left to the caller.
+        bool intersect(const ray3& ray, hit_test* const result) const noexcept;
+
+        bool occluded(const ray3& ray, const float max_distance) const noexcept;
+
+        // Returns the normalized world-space normal of the hit triangle, transformed by the inverse transpose of the instance's transform.
+        vec3 normal_at(const hit_test& hit) const noexcept;
+
+        inline vec2 texture_coordinates_at(const hit_test& hit) const noexcept
+        {
+            return asset->mesh.uv_at(hit.primitive_index, hit.uv);
+        }
+
+        inline uint material_index_at(const hit_test& hit) const noexcept
+        {
+            return material_override != NO_MATERIAL_OVERRIDE ? material_override : asset->mesh.material_index_of(hit.primitive_index);
+        }
+
+        TO_STRING(mesh_instance, "Asset=" << *asset << ",Material=" << material_override);
+    };
+};
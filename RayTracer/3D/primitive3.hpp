@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include "aabb.hpp"
 #include "ray3.hpp"
 #include "../material.hpp"
 
@@ -16,6 +17,10 @@ namespace ray_tracer_3d
         } type = hit_type::no_hit;
         float distance = INFINITY;
         vec2 uv;
+        // index of the hit primitive within the scene (see 'scene::primitive_count'). primitives themselves leave it unset, as they do not know their index.
+        uint primitive_index = ~0u;
+        // index of the hit mesh instance within the scene, whose asset the primitive index then refers to. ~0u for all other primitives.
+        uint instance_index = ~0u;
 
 
         TO_STRING(hit_test, (type == hit_type::hit ? "hit" : type == hit_type::tangential_hit ? "tangential-hit" : "no-hit") << ",D=" << distance << ",UV=" << uv);
@@ -31,7 +36,8 @@ namespace ray_tracer_3d
             triangle,
             sphere,
         } type;
-        material material;
+        // index into the material table of the scene the primitive belongs to (see 'scene::materials')
+        uint material_index = 0;
 
 
         primitive(float area, primitive_type type) noexcept
@@ -40,6 +46,8 @@ namespace ray_tracer_3d
         {
         }
 
+        virtual ~primitive() noexcept = default;
+
         inline float surface_area() const noexcept
         {
             return _area;
@@ -49,8 +57,20 @@ namespace ray_tracer_3d
 
         virtual vec2 UV_at(const vec3& vec) const = 0;
 
+        virtual aabb bounding_box() const = 0;
+
         virtual void intersect(const ray3& ray, hit_test* const result) const = 0;
 
+        // Returns whether the ray hits the primitive closer than 'max_distance'. Unlike 'intersect', this does not need to compute the hit's UV coordinates.
+        virtual bool occludes(const ray3& ray, const float max_distance) const
+        {
+            hit_test hit = hit_test();
+
+            intersect(ray, &hit);
+
+            return hit.type != hit_test::hit_type::no_hit && hit.distance < max_distance;
+        }
+
         virtual std::string to_string() const noexcept = 0;
 
         OSTREAM_OPERATOR(primitive);
@@ -70,7 +90,7 @@ namespace ray_tracer_3d
         }
 
         triangle(const vec3& a, const vec3& b, const vec3& c) noexcept
-            : primitive(B.sub(A).cross(C.sub(A)).length() / 2, primitive_type::triangle)
+            : primitive(b.sub(a).cross(c.sub(a)).length() / 2, primitive_type::triangle)
             , A(a)
             , B(b)
             , C(c)
@@ -95,6 +115,15 @@ namespace ray_tracer_3d
             );
         }
 
+        aabb bounding_box() const override
+        {
+            aabb box(A, B);
+
+            box.extend(C);
+
+            return box;
+        }
+
         bool möller_trumbore_intersect(
             const ray3& ray,
             float* const __restrict t,
@@ -194,6 +223,11 @@ namespace ray_tracer_3d
             );
         }
 
+        aabb bounding_box() const override
+        {
+            return aabb(center.sub(vec3(radius)), center.add(vec3(radius)));
+        }
+
         void intersect(const ray3& ray, hit_test* const result) const override
         {
             const vec3 oc = ray.origin.sub(center);
@@ -207,7 +241,10 @@ namespace ray_tracer_3d
             else
             {
                 const float fac = .5f / a;
-                const float dist = std::max(-b - sqrt(discr), -b + sqrt(discr)) * fac;
+                const float root = std::sqrt(std::max(discr, 0.f));
+                const float closest = (-b - root) * fac;
+                // the nearest intersection in front of the origin. rays starting inside the sphere (refracted ones) hit the far side
+                const float dist = closest > EPSILON ? closest : (-b + root) * fac;
 
                 if (dist > 0)
                 {
@@ -222,6 +259,25 @@ namespace ray_tracer_3d
             }
         }
 
+        bool occludes(const ray3& ray, const float max_distance) const override
+        {
+            const vec3 oc = ray.origin.sub(center);
+            const float a = ray.direction.squared_length();
+            const float b = 2 * oc.dot(ray.direction);
+            const float c = oc.squared_length() - radius2;
+            const float discr = b * b - 4 * a * c;
+
+            if (discr < -EPSILON)
+                return false;
+
+            const float fac = .5f / a;
+            const float root = std::sqrt(std::max(discr, 0.f));
+            const float closest = (-b - root) * fac;
+            const float dist = closest > EPSILON ? closest : (-b + root) * fac;
+
+            return dist > 0 && dist < max_distance;
+        }
+
         TO_STRING(sphere, "C=" << center << ",R=" << radius << ",Area=" << _area);
         CPP_IS_FUCKING_RETARDED(sphere);
     };
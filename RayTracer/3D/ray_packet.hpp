@@ -0,0 +1,106 @@
+#pragma once
+
+#include "primitive3.hpp"
+
+
+namespace ray_tracer_3d
+{
+    // A packet of up to MAX_SIZE coherent rays (e.g. the primary rays of a 4x4 pixel block), which are traversed through the acceleration structure together.
+    // Besides the per-ray data, the packet keeps conservative per-axis bounds of its origins and inverse directions, which form an interval "frustum" around all rays.
+    struct ray_packet
+    {
+        static constexpr int MAX_SIZE = 16;
+
+        const ray3* rays[MAX_SIZE];
+        float origin[3][MAX_SIZE];
+        float inv_direction[3][MAX_SIZE];
+        float origin_min[3];
+        float origin_max[3];
+        float inv_direction_min[3];
+        float inv_direction_max[3];
+        // whether all directions share their sign on every axis. the interval test is only conservative if this holds.
+        bool is_coherent;
+        int size;
+
+
+        ray_packet(const ray3* const rays, const int count) noexcept
+            : is_coherent(true)
+            , size(std::min(count, MAX_SIZE))
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                origin_min[axis] = inv_direction_min[axis] = std::numeric_limits<float>::infinity();
+                origin_max[axis] = inv_direction_max[axis] = -std::numeric_limits<float>::infinity();
+            }
+
+            for (int i = 0; i < size; ++i)
+            {
+                const ray3& ray = rays[i];
+                const float o[3] = { ray.origin.X, ray.origin.Y, ray.origin.Z };
+                const float d[3] = { ray.direction.X, ray.direction.Y, ray.direction.Z };
+
+                this->rays[i] = &ray;
+
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    origin[axis][i] = o[axis];
+                    inv_direction[axis][i] = 1.f / d[axis];
+                    origin_min[axis] = std::min(origin_min[axis], o[axis]);
+                    origin_max[axis] = std::max(origin_max[axis], o[axis]);
+                    inv_direction_min[axis] = std::min(inv_direction_min[axis], inv_direction[axis][i]);
+                    inv_direction_max[axis] = std::max(inv_direction_max[axis], inv_direction[axis][i]);
+                }
+            }
+
+            for (int axis = 0; axis < 3; ++axis)
+                is_coherent &= inv_direction_min[axis] > 0.f || inv_direction_max[axis] < 0.f;
+        }
+
+        // Conservative interval test: returns false only if no ray of the packet can intersect the box closer than 'max_distance'.
+        inline bool may_intersect(const aabb& box, const float max_distance) const noexcept
+        {
+            if (!is_coherent)
+                return true;
+
+            float t_near = 0.f;
+            float t_far = max_distance;
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                // the slab distances (plane - origin) * inv_direction are bounded by the products of the interval ends
+                const float near_plane = inv_direction_min[axis] > 0.f ? box.min[axis] : box.max[axis];
+                const float far_plane = inv_direction_min[axis] > 0.f ? box.max[axis] : box.min[axis];
+                const float n0 = (near_plane - origin_max[axis]) * inv_direction_min[axis];
+                const float n1 = (near_plane - origin_max[axis]) * inv_direction_max[axis];
+                const float n2 = (near_plane - origin_min[axis]) * inv_direction_min[axis];
+                const float n3 = (near_plane - origin_min[axis]) * inv_direction_max[axis];
+                const float f0 = (far_plane - origin_max[axis]) * inv_direction_min[axis];
+                const float f1 = (far_plane - origin_max[axis]) * inv_direction_max[axis];
+                const float f2 = (far_plane - origin_min[axis]) * inv_direction_min[axis];
+                const float f3 = (far_plane - origin_min[axis]) * inv_direction_max[axis];
+
+                t_near = std::max(t_near, std::min(std::min(n0, n1), std::min(n2, n3)));
+                t_far = std::min(t_far, std::max(std::max(f0, f1), std::max(f2, f3)));
+            }
+
+            return t_near <= t_far;
+        }
+
+        // Returns the index of the first ray which intersects the box closer than its current hit distance, or -1 if none does.
+        inline int first_hit(const aabb& box, const hit_test* const results, float* const entry) const noexcept
+        {
+            for (int i = 0; i < size; ++i)
+            {
+                const float o[3] = { origin[0][i], origin[1][i], origin[2][i] };
+                const float inv_d[3] = { inv_direction[0][i], inv_direction[1][i], inv_direction[2][i] };
+
+                if (box.intersect(o, inv_d, results[i].distance, entry))
+                    return i;
+            }
+
+            return -1;
+        }
+
+        TO_STRING(ray_packet, "Size=" << size << ",Coherent=" << is_coherent);
+    };
+};
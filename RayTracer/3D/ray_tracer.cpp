@@ -1,12 +1,436 @@
 ﻿#include "ray_tracer.hpp"
 
-#define INIT_RAND std::srand(std::time(nullptr))
-#define float_RAND (float(std::rand()) / RAND_MAX)
 
 
 using namespace ray_tracer_3d;
 
 
+// Shades the hit (or miss) found for the given ray and appends it to the trace result. This is everything 'TraceRay3' does after its intersection query.
+static ray_trace_iteration complete_iteration(const scene* const __restrict scene, const render_configuration& config, ray_trace_result* const __restrict result, const ray3& ray, const hit_test& hit, primitive* const primitive, const float throughput, pcg32* const rng)
+{
+    ray_trace_iteration iteration = ray_trace_iteration();
+
+    iteration.ray = ray;
+    iteration.hit = hit;
+    iteration.primitive = primitive;
+
+    // the triangles of indexed meshes and instances have no primitive and are only identified by their indices
+    if (scene->is_surface_hit(hit))
+    {
+        iteration.intersection_point = iteration.ray(iteration.hit.distance);
+        iteration.surface_normal = scene->normal_at(hit, iteration.intersection_point);
+        iteration.texture_coordinates = scene->texture_coordinates_at(hit);
+    }
+
+    if (iteration.hit.type != hit_test::hit_type::no_hit && iteration.hit.distance < INFINITY)
+        ComputeColor3(scene, config, result, &iteration, throughput, rng);
+    else
+        iteration.computed_color = config.background_color;
+
+    result->push_back(iteration);
+
+    return iteration;
+}
+
+// Traces a secondary ray, whose contribution to the current path is scaled by 'weight'. Paths with a throughput below RUSSIAN_ROULETTE_THRESHOLD are continued
+// only with a probability proportional to their throughput and are weighted up accordingly if they survive, which keeps the expected color unchanged.
+static ARGB trace_secondary_ray(const scene* const __restrict scene, const render_configuration& config, ray_trace_result* const __restrict result, const ray3& ray, float weight, const float throughput, pcg32* const rng)
+{
+    float path_throughput = throughput * weight;
+
+    if (path_throughput <= 0)
+        return ARGB::TRANSPARENT;
+    else if (rng && path_throughput < RUSSIAN_ROULETTE_THRESHOLD)
+    {
+        const float survival = path_throughput / RUSSIAN_ROULETTE_THRESHOLD;
+
+        if (rng->next_float() >= survival)
+            return ARGB::TRANSPARENT;
+
+        weight /= survival;
+        path_throughput = RUSSIAN_ROULETTE_THRESHOLD;
+    }
+
+    return TraceRay3(scene, config, result, ray, path_throughput, rng).computed_color * weight;
+}
+
+// Maps a traced sample to its output color according to the configured render mode.
+static ARGB resolve_sample_color(const render_configuration& config, const ray3& ray, const ray_trace_iteration& iteration, const size_t iteration_count, const std::chrono::nanoseconds elapsed)
+{
+    const bool is_hit = iteration.hit.type != hit_test::hit_type::no_hit;
+    ARGB color = ARGB();
+
+    switch (config.mode)
+    {
+        case render_mode::depths:
+            if (is_hit)
+                color = ARGB(1.f / (1 + .25f * iteration.hit.distance));
+
+            break;
+        case render_mode::wireframe:
+            if (is_hit)
+            {
+                const float u = iteration.hit.uv.X;
+                const float v = iteration.hit.uv.Y;
+                const float w = 1 - u - v;
+                const int h = std::min(w, std::min(u, v)) <= .01;
+
+                color = ARGB(h * u, h * v, h * w);
+            }
+
+            break;
+        case render_mode::uv_coords:
+            if (is_hit)
+            {
+                const float u = iteration.texture_coordinates.X;
+                const float v = iteration.texture_coordinates.Y;
+
+                color = ARGB(u, v, 1 - u - v);
+            }
+
+            break;
+        case render_mode::surface_normals:
+            if (is_hit)
+                color = iteration.surface_normal.add(vec3(1)).scale(.5f);
+
+            break;
+        case render_mode::ray_direction:
+            color = ray.direction.add(vec3(1)).scale(.5f);
+
+            break;
+        case render_mode::ray_incidence_angle:
+            if (is_hit)
+                color = ARGB(1 - std::abs(ray.direction.angle_to(iteration.surface_normal) / ROT_90));
+
+            break;
+        case render_mode::iterations:
+            color = ARGB(1.f - iteration_count / float(config.maximum_iteration_count));
+
+            break;
+        case render_mode::render_time:
+        {
+            const float µs = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+
+            color = ARGB(std::log10(µs) * .30293575075f);
+        } break;
+        case render_mode::hit_type:
+            color = iteration.hit.type == hit_test::hit_type::no_hit ? ARGB::RED :
+                    iteration.hit.type == hit_test::hit_type::tangential_hit ? ARGB::BLUE : ARGB::GREEN;
+
+            break;
+        case render_mode::realistic_colors:
+        case render_mode::diffuse_colors:
+        default:
+            color = iteration.computed_color;
+
+            break;
+    }
+
+    return color;
+}
+
+// Running mean and variance of the luminance of a pixel's samples (Welford's algorithm), from which adaptive sampling decides whether the pixel has converged.
+struct pixel_statistics
+{
+    float mean = 0;
+    float m2 = 0;
+    int count = 0;
+    bool converged = false;
+
+
+    inline void add(const float value) noexcept
+    {
+        const float delta = value - mean;
+
+        mean += delta / ++count;
+        m2 += delta * (value - mean);
+    }
+
+    // Tests whether the standard error of the mean, sqrt(variance / count), is below the threshold (relative to the mean if the mean is above one).
+    inline bool is_below(const float threshold) const noexcept
+    {
+        const float variance = m2 / (count - 1);
+        const float scale = std::max(1.f, mean);
+
+        return count > 1 && variance <= threshold * threshold * scale * scale * count;
+    }
+};
+
+// Returns the trace result reused for all samples of the calling thread.
+static inline ray_trace_result& thread_result() noexcept
+{
+    thread_local ray_trace_result result;
+
+    return result;
+}
+
+// Creates the primary ray through the image plane point (x, y). If a generator is given, the point is jittered by up to one pixel of a w x h image.
+static inline ray3 create_primary_ray(const render_configuration& config, const camera& camera, const float w, const float h, float x, float y, pcg32* const rng)
+{
+    if (rng)
+    {
+        x += 2 * rng->next_float() / w;
+        y += 2 * rng->next_float() / h;
+    }
+
+    return camera.create_ray(camera.direction(x, y), config.air_refraction_index);
+}
+
+// Traces one sample of every subpixel of the given pixel and returns their mean.
+static ARGB sample_pixel(const scene* const scene, const render_configuration& config, const camera& camera, const int raw_x, const int raw_y, const int sample)
+{
+    const int w = config.horizontal_resolution;
+    const int h = config.vertical_resolution;
+    const int sub = config.subpixels_per_pixel;
+    const float subd(sub);
+    const float pixel_x = raw_x / float(w) * 2.f - 1.f;
+    const float pixel_y = 1.f - raw_y / float(h) * 2.f;
+    const float norm_factor = 1.f / (subd * subd);
+    const size_t index = raw_x + size_t(raw_y * w);
+    pcg32 rng = pcg32::for_sample(config.seed, index, sample);
+    ray_trace_result& result = thread_result();
+    ARGB total = ARGB();
+
+    for (int sx = 0; sx < sub; ++sx)
+    {
+        const float x = float((sx + .5f) / subd) / w + pixel_x;
+
+        for (int sy = 0; sy < sub; ++sy)
+        {
+            const float y = float((sy + .5f) / subd) / w + pixel_y;
+            const auto start = std::chrono::high_resolution_clock::now();
+            const ray3 ray = create_primary_ray(config, camera, w, h, x, y, &rng);
+
+            result.reset(config.maximum_iteration_count, config.record_history);
+
+            const ray_trace_iteration iteration = TraceRay3(scene, config, &result, ray, 1.f, &rng);
+            const std::chrono::nanoseconds elapsed = std::chrono::high_resolution_clock::now() - start;
+
+            total += resolve_sample_color(config, ray, iteration, result.size(), elapsed) * norm_factor;
+        }
+    }
+
+    return total;
+}
+
+// Traces one sample of every subpixel of the given pixel block, tracing the primary rays of each subpixel as one packet. The mean of every pixel is written to
+// 'colors' in row-major order.
+static void sample_packet(const scene* const scene, const render_configuration& config, const camera& camera, const int raw_x, const int raw_y, const int packet_w, const int packet_h, ARGB* const colors, const int sample)
+{
+    const int w = config.horizontal_resolution;
+    const int h = config.vertical_resolution;
+    const int sub = config.subpixels_per_pixel;
+    const int count = packet_w * packet_h;
+    const float subd(sub);
+    const float norm_factor = 1.f / (subd * subd);
+    ray3 rays[ray_packet::MAX_SIZE];
+    hit_test hits[ray_packet::MAX_SIZE];
+    primitive* primitives[ray_packet::MAX_SIZE];
+    pcg32 rngs[ray_packet::MAX_SIZE];
+    float xs[ray_packet::MAX_SIZE], ys[ray_packet::MAX_SIZE];
+    float dx[ray_packet::MAX_SIZE], dy[ray_packet::MAX_SIZE], dz[ray_packet::MAX_SIZE];
+    ray_trace_result& result = thread_result();
+
+    assert(count > 0 && count <= ray_packet::MAX_SIZE);
+
+    // every pixel draws from its own generator in the same order as in 'render_pixel', so that both produce the same jitter
+    for (int i = 0; i < count; ++i)
+    {
+        const size_t index = raw_x + i % packet_w + size_t((raw_y + i / packet_w) * w);
+
+        rngs[i] = pcg32::for_sample(config.seed, index, sample);
+        colors[i] = ARGB();
+    }
+
+    // every packet covers the same subpixel of all pixels in the block
+    for (int sx = 0; sx < sub; ++sx)
+        for (int sy = 0; sy < sub; ++sy)
+        {
+            const auto start = std::chrono::high_resolution_clock::now();
+
+            for (int i = 0; i < count; ++i)
+            {
+                const float pixel_x = (raw_x + i % packet_w) / float(w) * 2.f - 1.f;
+                const float pixel_y = 1.f - (raw_y + i / packet_w) / float(h) * 2.f;
+
+                xs[i] = float((sx + .5f) / subd) / w + pixel_x + 2 * rngs[i].next_float() / w;
+                ys[i] = float((sy + .5f) / subd) / w + pixel_y + 2 * rngs[i].next_float() / h;
+            }
+
+            camera.directions(xs, ys, count, dx, dy, dz);
+
+            for (int i = 0; i < count; ++i)
+            {
+                rays[i] = camera.create_ray(vec3(dx[i], dy[i], dz[i]), config.air_refraction_index);
+                hits[i] = hit_test();
+                hits[i].distance = INFINITY;
+                primitives[i] = nullptr;
+            }
+
+            if (config.maximum_iteration_count > 0)
+                scene->intersect(rays, count, hits, primitives);
+
+            const std::chrono::nanoseconds elapsed = (std::chrono::high_resolution_clock::now() - start) / count;
+
+            // only the primary rays are traced as a packet. all secondary rays spawned during shading are traced on their own.
+            for (int i = 0; i < count; ++i)
+            {
+                result.reset(config.maximum_iteration_count, config.record_history);
+
+                const ray_trace_iteration iteration = config.maximum_iteration_count > 0 ? complete_iteration(scene, config, &result, rays[i], hits[i], primitives[i], 1.f, rngs + i)
+                                                                                         : ray_trace_iteration();
+
+                colors[i] += resolve_sample_color(config, rays[i], iteration, result.size(), elapsed) * norm_factor;
+            }
+        }
+}
+
+// Traces one sample of every pixel of the tile for which 'is_active(index)' holds and calls 'func(index, color)' with each such pixel's color. Pixels are
+// identified by their row-major index within the tile. They are traced in square packets of 'packet_size' x 'packet_size' pixels (or one by one for a size
+// of 1), which are clipped at the tile borders. A packet is traced as long as one of its pixels is active.
+template<typename P, typename F>
+static void sample_tile(const scene* const scene, const render_configuration& config, const camera& camera, const tile& tile, const int packet_size, const int sample, const P& is_active, const F& func)
+{
+    const size_t w = tile.width;
+    ARGB colors[ray_packet::MAX_SIZE];
+    bool active[ray_packet::MAX_SIZE];
+
+    for (int y = tile.y; y < tile.y + tile.height; y += packet_size)
+        for (int x = tile.x; x < tile.x + tile.width; x += packet_size)
+            if (packet_size > 1)
+            {
+                const int packet_w = std::min(packet_size, tile.x + tile.width - x);
+                const int packet_h = std::min(packet_size, tile.y + tile.height - y);
+                bool any_active = false;
+
+                for (int i = 0; i < packet_w * packet_h; ++i)
+                    any_active |= active[i] = is_active(x - tile.x + i % packet_w + (y - tile.y + i / packet_w) * w);
+
+                if (!any_active)
+                    continue;
+
+                sample_packet(scene, config, camera, x, y, packet_w, packet_h, colors, sample);
+
+                for (int i = 0; i < packet_w * packet_h; ++i)
+                    if (active[i])
+                        func(x - tile.x + i % packet_w + (y - tile.y + i / packet_w) * w, colors[i]);
+            }
+            else if (is_active(x - tile.x + (y - tile.y) * w))
+                func(x - tile.x + (y - tile.y) * w, sample_pixel(scene, config, camera, x, y, sample));
+}
+
+// Encodes the tile's colors, which are stored row by row, into the image buffer 'buffer' of 'width' pixels per row.
+static void write_tile(const pixel_encoder& encoder, const tile& tile, const ARGB* const __restrict colors, void* const __restrict buffer, const size_t width) noexcept
+{
+    const size_t pixel_size = encoder.pixel_size();
+
+    for (int y = 0; y < tile.height; ++y)
+        encoder.encode(colors + size_t(y) * tile.width, tile.width, static_cast<char*>(buffer) + (tile.x + size_t(tile.y + y) * width) * pixel_size);
+}
+
+static inline bool every_pixel(const size_t) noexcept
+{
+    return true;
+}
+
+static inline bool is_cancelled(const std::atomic<bool>* const cancellation) noexcept
+{
+    return cancellation && cancellation->load(std::memory_order_relaxed);
+}
+
+// Renders the samples of every pixel of the tile into 'colors', but stops sampling a pixel as soon as its mean has converged (see
+// 'render_configuration::adaptive_threshold'). The tile's budget of 'samples_per_subpixel' samples per pixel is redistributed: once every pixel has had
+// its regular samples, further rounds sample only the pixels which have not converged yet, as long as the samples saved on the others pay for the round
+// and up to ADAPTIVE_MAXIMUM_SAMPLE_FACTOR times the regular count. The image therefore depends on the tile size, but not on the thread count or the
+// tile order. Returns the number of pixel samples traced. The progress is advanced by the full budget of the tile, including the unspent samples.
+static size_t render_tile_adaptive(
+    const scene* const scene,
+    const render_configuration& config,
+    const camera& camera,
+    const tile& tile,
+    const int packet_size,
+    ARGB* const colors,
+    render_progress& progress,
+    const int worker,
+    const std::atomic<bool>* const cancellation
+)
+{
+    const size_t subpixel_count = config.subpixels_per_pixel * config.subpixels_per_pixel;
+    thread_local std::vector<pixel_statistics> statistics;
+    const size_t minimum_samples = config.adaptive_minimum_samples ? config.adaptive_minimum_samples : ADAPTIVE_MINIMUM_SAMPLES;
+    const size_t regular_samples = config.samples_per_subpixel;
+    const size_t maximum_samples = regular_samples * ADAPTIVE_MAXIMUM_SAMPLE_FACTOR;
+    const size_t budget = tile.pixel_count() * regular_samples;
+    size_t active_count = tile.pixel_count();
+    size_t traced = 0;
+
+    statistics.assign(tile.pixel_count(), pixel_statistics());
+
+    // rounds beyond the regular samples only run if all of their samples fit into the budget, which keeps the work per tile bounded
+    for (size_t sample = 0; sample < maximum_samples && active_count && (sample < regular_samples || traced + active_count <= budget) && !is_cancelled(cancellation); ++sample)
+    {
+        sample_tile(scene, config, camera, tile, packet_size, sample, [&](const size_t index)
+        {
+            return !statistics[index].converged;
+        }, [&](const size_t index, const ARGB& color)
+        {
+            colors[index] = sample ? colors[index] + color : color;
+            statistics[index].add(color.luminance());
+        });
+
+        traced += active_count;
+        progress.advance(worker, active_count * subpixel_count);
+
+        if (sample + 1 >= minimum_samples)
+            for (pixel_statistics& pixel : statistics)
+                if (!pixel.converged && pixel.is_below(config.adaptive_threshold))
+                {
+                    pixel.converged = true;
+                    --active_count;
+                }
+    }
+
+    for (size_t index = 0; index < tile.pixel_count(); ++index)
+        colors[index] = config.background_color + colors[index] / float(statistics[index].count);
+
+    progress.advance(worker, (budget - traced) * subpixel_count);
+
+    return traced;
+}
+
+// Returns the number of render threads requested by the configuration and makes sure that the task pool provides them.
+static int reserve_render_threads(const render_configuration& config) noexcept
+{
+    const int thread_count = config.thread_count ? int(config.thread_count) : task_pool::instance().thread_count();
+
+    task_pool::instance().reserve(thread_count);
+
+    return thread_count;
+}
+
+// Creates the progress of a render of 'row_count' rows with 'samples' samples per subpixel, which counts the traced subpixel samples, and reserves the
+// render threads for it.
+static render_progress create_progress(const render_configuration& config, const size_t row_count, const size_t samples) noexcept
+{
+    const size_t w = config.horizontal_resolution;
+    const size_t h = row_count;
+    const size_t sub = config.subpixels_per_pixel;
+
+    return render_progress(w, h, config.tile_size, reserve_render_threads(config), w * h * sub * sub * samples);
+}
+
+// Publishes the current progress to the host's progress value. Only the first worker writes it, so that the reported value never decreases.
+static inline void publish_progress(float* const progress, const render_progress& tracker, const int worker) noexcept
+{
+    if (progress && !worker)
+        *progress = tracker.fraction();
+}
+
+static inline int packet_size_of(const ray_packet_mode mode) noexcept
+{
+    return mode == ray_packet_mode::packets_4x4 ? 4 : mode == ray_packet_mode::packets_2x2 ? 2 : 1;
+}
+
 scene* ray_tracer_3d::CreateScene3()
 {
     scene* sc = new scene();
@@ -42,253 +466,558 @@ void ray_tracer_3d::DeleteScene3(scene* const scene)
     }
 }
 
-float ray_tracer_3d::RenderImage3(const scene* const __restrict scene, render_configuration const config, ARGB* const __restrict buffer, float* const __restrict progress)
+scene* ray_tracer_3d::LoadScene3(const char* const path)
 {
-    assert(buffer != nullptr);
+    assert(path != nullptr);
+
+    std::string error;
+    scene* const scene = load_scene(path, &error);
+
+    if (!scene)
+        std::cerr << "Unable to load the scene '" << path << "': " << error << "." << std::endl;
+
+    return scene;
+}
+
+bool ray_tracer_3d::SaveScene3(const scene* const scene, const char* const path)
+{
+    assert(scene != nullptr && path != nullptr);
+
+    std::string error;
+    const bool saved = save_scene(*scene, path, &error);
+
+    if (!saved)
+        std::cerr << "Unable to save the scene: " << error << "." << std::endl;
+
+    return saved;
+}
+
+bool ray_tracer_3d::ImportMesh3(scene* const scene, const char* const path)
+{
+    assert(scene != nullptr && path != nullptr);
+
+    std::string error;
+    indexed_mesh mesh;
+
+    if (!import_mesh(path, material::diffuse(ARGB::WHITE), &mesh, &error))
+    {
+        std::cerr << "Unable to import the mesh '" << path << "': " << error << "." << std::endl;
+
+        return false;
+    }
+
+    scene->add_indexed_mesh(mesh);
+    ++scene->revision;
+
+    return true;
+}
+
+uint ray_tracer_3d::AddMeshAsset3(scene* const scene, const char* const path)
+{
+    assert(scene != nullptr && path != nullptr);
+
+    std::string error;
+    indexed_mesh mesh;
+
+    if (!import_mesh(path, material::diffuse(ARGB::WHITE), &mesh, &error))
+    {
+        std::cerr << "Unable to import the mesh '" << path << "': " << error << "." << std::endl;
+
+        return ~0u;
+    }
 
-    INIT_RAND;
+    return scene->add_mesh_asset(mesh);
+}
+
+bool ray_tracer_3d::AddInstance3(scene* const scene, const uint asset, const float* const transform, const uint material_override)
+{
+    assert(scene != nullptr && transform != nullptr);
+
+    if (!scene->add_instance(asset, affine_transform(transform), material_override))
+        return false;
+
+    ++scene->revision;
+
+    return true;
+}
+
+size_t ray_tracer_3d::GetMaterialCount3(const scene* const scene)
+{
+    assert(scene != nullptr);
+
+    return scene->materials.size();
+}
+
+bool ray_tracer_3d::GetMaterial3(const scene* const __restrict scene, const uint index, material* const __restrict mat)
+{
+    assert(scene != nullptr && mat != nullptr);
+
+    if (index >= scene->materials.size())
+        return false;
+
+    *mat = scene->materials[index];
+
+    return true;
+}
+
+bool ray_tracer_3d::SetMaterial3(scene* const scene, const uint index, const material mat)
+{
+    assert(scene != nullptr);
+
+    if (index >= scene->materials.size())
+        return false;
+
+    scene->materials[index] = mat;
+    ++scene->revision;
+
+    return true;
+}
+
+float ray_tracer_3d::RebuildScene3(scene* const scene)
+{
+    assert(scene != nullptr);
+
+    const auto timer = std::chrono::high_resolution_clock::now();
+
+    scene->rebuild_acceleration_structure();
+    ++scene->revision;
+
+    const auto elapsed = std::chrono::high_resolution_clock::now() - timer;
+
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+float ray_tracer_3d::RefitScene3(scene* const scene)
+{
+    assert(scene != nullptr);
+
+    const auto timer = std::chrono::high_resolution_clock::now();
+
+    scene->refit_acceleration_structure();
+    ++scene->revision;
+
+    const auto elapsed = std::chrono::high_resolution_clock::now() - timer;
+
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+// Renders the rows [first_row, first_row + row_count) of the image as described for 'RenderRows3' and reports its progress to 'tracker', which must have
+// been created through 'create_progress' for the same number of rows. The tiles are laid out relative to the first row. If the given cancellation flag
+// is raised, all remaining tiles are skipped and a negative time is returned.
+static float render_image(
+    const scene* const __restrict scene,
+    const render_configuration& config,
+    const int first_row,
+    const int row_count,
+    void* const __restrict buffer,
+    render_progress& tracker,
+    float* const __restrict progress,
+    const std::atomic<bool>* const cancellation
+)
+{
+    assert(buffer != nullptr);
 
     const int w = config.horizontal_resolution;
     const int h = config.vertical_resolution;
     const int sub = config.subpixels_per_pixel;
-    const size_t total_samples = size_t(w) * h * sub * sub * config.samples_per_subpixel;
+    const size_t total_samples = size_t(w) * row_count * sub * sub * config.samples_per_subpixel;
+
+    scene->update_acceleration_structure();
+
+    tile_scheduler scheduler(w, row_count, config.tile_size, config.tile_ordering);
+    const int thread_count = tracker.worker_count();
 
     if (config.debug)
         std::cout << std::endl << "----------------------------------------------------------------" << std::endl
             << "Resolution(in pixels) : " << w << "x" << h << std::endl
+            << "                 Rows : " << first_row << " to " << first_row + row_count - 1 << std::endl
             << "  Subpixels per pixel : " << sub << "x" << sub << std::endl
             << " Samples per subpixel : " << config.samples_per_subpixel << std::endl
             << "    Maximum ray depth : " << config.maximum_iteration_count << std::endl
             << "    Minimum ray count : " << total_samples << std::endl
             << "    Maximum ray count : " << total_samples * config.maximum_iteration_count << std::endl
             << "       Triangle count : " << scene->mesh.size() << std::endl
+            << "       BVH node count : " << scene->acceleration_structure.node_count() << std::endl
             << "          Render mode : " << config.mode << std::endl
+            << "          Packet mode : " << config.packet_mode << std::endl
+            << "           Tile count : " << scheduler.tile_count() << std::endl
+            << "         Thread count : " << thread_count << std::endl
+            << "   Adaptive threshold : " << config.adaptive_threshold << std::endl
             << "----------------------------------------------------------------" << std::endl;
 
     auto total_timer = std::chrono::high_resolution_clock::now();
-    constexpr int CUBE_SZ = 128;
-    std::atomic<size_t> pass_counter(size_t(0));
+    const camera frame_camera(config.camera, w, h);
+    const int packet_size = packet_size_of(config.packet_mode);
+    const float sample_count(config.samples_per_subpixel);
+    const size_t subpixel_count = size_t(sub) * sub;
+    const pixel_encoder encoder(config.output_format, config.tonemap, config.exposure);
+    std::atomic<size_t> traced_samples(size_t(0));
 
     if (progress)
         *progress = 0;
 
-    for (int base_y = 0; base_y < h; base_y += CUBE_SZ)
-        for (int base_x = 0; base_x < w; base_x += CUBE_SZ)
-        {
-            const int block_w = std::min(w - base_x, CUBE_SZ);
-            const int block_h = std::min(h - base_y, CUBE_SZ);
+    scheduler.run(thread_count, [&](const tile& tile, const int worker)
+    {
+        // the samples of a tile are accumulated in a buffer small enough to stay in the cache, which is only resolved into the image once
+        thread_local std::vector<ARGB> colors;
+
+        // the tile in image coordinates, whose pixels are sampled
+        const struct tile frame_tile = { tile.x, tile.y + first_row, tile.width, tile.height };
+
+        if (is_cancelled(cancellation))
+            return;
 
-            concurrency::parallel_for(
-                size_t(0),
-                size_t(block_w) * size_t(block_h),
-                [&](size_t index)
+        colors.resize(tile.pixel_count());
+
+        if (config.adaptive_threshold > 0)
+            traced_samples += render_tile_adaptive(scene, config, frame_camera, frame_tile, packet_size, colors.data(), tracker, worker, cancellation);
+        else
+        {
+            for (int sample = 0; sample < config.samples_per_subpixel && !is_cancelled(cancellation); ++sample)
+            {
+                sample_tile(scene, config, frame_camera, frame_tile, packet_size, sample, every_pixel, [&](const size_t index, const ARGB& color)
                 {
-                    const int pixel_x = base_x + index % block_w;
-                    const int pixel_y = base_y + index / block_w;
+                    if (!sample)
+                        colors[index] = config.background_color;
 
-                    for (int sample = 0; sample < config.samples_per_subpixel; ++sample)
-                    {
-                        ComputeRenderPass3(scene, config, pixel_x, pixel_y, buffer, !sample);
+                    colors[index] += color / sample_count;
+                });
 
-                        if (progress)
-                            *progress = float(++pass_counter) / (float(w) * h * config.samples_per_subpixel);
-                    }
-                }
-            );
+                tracker.advance(worker, tile.pixel_count() * subpixel_count);
+            }
+
+            traced_samples += tile.pixel_count() * config.samples_per_subpixel;
         }
 
+        if (is_cancelled(cancellation))
+            return;
+
+        write_tile(encoder, tile, colors.data(), buffer, w);
+        tracker.complete(tile);
+
+        publish_progress(progress, tracker, worker);
+    });
+
     const auto elapsed = std::chrono::high_resolution_clock::now() - total_timer;
 
+    if (progress)
+        *progress = tracker.fraction();
+
+    if (config.debug)
+        std::cout << "Traced " << traced_samples << " of " << size_t(w) * row_count * config.samples_per_subpixel << " pixel samples" << std::endl;
+
+    if (is_cancelled(cancellation))
+        return -1;
+
     return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
 }
 
-void ray_tracer_3d::ComputeRenderPass3(const scene* const scene, const render_configuration& config, const int raw_x, const int raw_y, ARGB* const& buffer, const bool clear)
+float ray_tracer_3d::RenderImage3(const scene* const __restrict scene, render_configuration const config, void* const __restrict buffer, float* const __restrict progress)
+{
+    render_progress tracker = create_progress(config, config.vertical_resolution, config.samples_per_subpixel);
+
+    return render_image(scene, config, 0, config.vertical_resolution, buffer, tracker, progress, nullptr);
+}
+
+float ray_tracer_3d::RenderRows3(
+    const scene* const __restrict scene,
+    render_configuration const config,
+    const size_t first_row,
+    const size_t row_count,
+    void* const __restrict buffer,
+    float* const __restrict progress
+)
+{
+    assert(first_row + row_count <= config.vertical_resolution);
+
+    render_progress tracker = create_progress(config, row_count, config.samples_per_subpixel);
+
+    return render_image(scene, config, first_row, row_count, buffer, tracker, progress, nullptr);
+}
+
+ray_tracer_3d::render_job::render_job(const scene* const scene, const render_configuration& config, void* const buffer) noexcept
+    : _progress(create_progress(config, config.vertical_resolution, config.samples_per_subpixel))
+    , _result(std::async(std::launch::async, [this, scene, config, buffer]
+    {
+        const float µs = render_image(scene, config, 0, config.vertical_resolution, buffer, _progress, nullptr, &_cancellation_requested);
+
+        _state = µs < 0 ? render_job_state::cancelled : render_job_state::completed;
+
+        return µs;
+    }))
+{
+}
+
+render_job* ray_tracer_3d::StartRender3(const scene* const __restrict scene, render_configuration const config, void* const __restrict buffer)
+{
+    assert(scene != nullptr && buffer != nullptr);
+
+    // the structures are rebuilt here rather than on the job's thread, where the rebuild could race with that of a cancelled job which is still running.
+    // 'render_image' then finds them valid and leaves them untouched.
+    scene->update_acceleration_structure();
+
+    return new render_job(scene, config, buffer);
+}
+
+render_job_state ray_tracer_3d::PollRender3(const render_job* const __restrict job, float* const __restrict progress)
+{
+    assert(job != nullptr);
+
+    if (progress)
+        *progress = job->progress().fraction();
+
+    return job->state();
+}
+
+size_t ray_tracer_3d::GetCompletedTiles3(const render_job* const __restrict job, unsigned long long* const __restrict bitmap, const size_t word_count)
 {
+    assert(job != nullptr && bitmap != nullptr);
+
+    return job->progress().completed_tiles(bitmap, word_count);
+}
+
+void ray_tracer_3d::GetTileGrid3(const render_job* const __restrict job, int* const __restrict tile_size, int* const __restrict columns, int* const __restrict rows)
+{
+    assert(job != nullptr);
+
+    const render_progress& progress = job->progress();
+
+    if (tile_size)
+        *tile_size = progress.tile_size();
+
+    if (columns)
+        *columns = progress.columns();
+
+    if (rows)
+        *rows = progress.rows();
+}
+
+void ray_tracer_3d::CancelRender3(render_job* const job)
+{
+    assert(job != nullptr);
+
+    job->cancel();
+}
+
+float ray_tracer_3d::WaitRender3(render_job* const job)
+{
+    assert(job != nullptr);
+
+    const float µs = job->wait();
+
+    delete job;
+
+    return µs;
+}
+
+bool ray_tracer_3d::accumulation_buffer::is_same_frame(const scene* const scene, const render_configuration& config) const noexcept
+{
+    // the camera and the background color consist of floats only (the padding lane of 'vec3' is always zero), so that they can be compared bytewise.
+    // edits of the scene itself are covered by its revision.
+    return scene->id == _scene_id
+        && scene->revision == _scene_revision
+        && config.horizontal_resolution == _config.horizontal_resolution
+        && config.vertical_resolution == _config.vertical_resolution
+        && config.subpixels_per_pixel == _config.subpixels_per_pixel
+        && config.maximum_iteration_count == _config.maximum_iteration_count
+        && !std::memcmp(&config.camera, &_config.camera, sizeof(camera_configuration))
+        && config.mode == _config.mode
+        && !std::memcmp(&config.background_color, &_config.background_color, sizeof(ARGB))
+        && config.air_refraction_index == _config.air_refraction_index
+        && config.seed == _config.seed;
+}
+
+void ray_tracer_3d::accumulation_buffer::reset(const scene* const scene, const render_configuration& config) noexcept
+{
+    _scene_id = scene->id;
+    _scene_revision = scene->revision;
+    _config = config;
+    _sample_count = 0;
+    _sums.resize(config.horizontal_resolution * config.vertical_resolution * 4);
+}
+
+accumulation_buffer* ray_tracer_3d::CreateAccumulationBuffer3()
+{
+    return new accumulation_buffer();
+}
+
+void ray_tracer_3d::DeleteAccumulationBuffer3(accumulation_buffer* const buffer)
+{
+    delete buffer;
+}
+
+void ray_tracer_3d::ResetAccumulationBuffer3(accumulation_buffer* const buffer)
+{
+    assert(buffer != nullptr);
+
+    buffer->reset();
+}
+
+size_t ray_tracer_3d::GetAccumulatedSampleCount3(const accumulation_buffer* const buffer)
+{
+    assert(buffer != nullptr);
+
+    return buffer->sample_count();
+}
+
+float ray_tracer_3d::RenderProgressive3(const scene* const __restrict scene, render_configuration const config, accumulation_buffer* const __restrict buffer, float* const __restrict progress)
+{
+    assert(buffer != nullptr);
+
     const int w = config.horizontal_resolution;
     const int h = config.vertical_resolution;
-    const int sub = config.subpixels_per_pixel;
-    const float subd(sub);
-    const float pixel_x = raw_x / float(w) * 2.f - 1.f;
-    const float pixel_y = 1.f - raw_y / float(h) * 2.f;
-    const float norm_factor = 1.f / (subd * subd);
-    const size_t index = raw_x + size_t(raw_y * w);
-    ARGB total = ARGB();
 
-    if (clear)
-        buffer[index] = config.background_color;
+    // a modified mesh invalidates the acceleration structure, and with it all accumulated passes
+    if (!buffer->is_same_frame(scene, config) || !scene->is_acceleration_structure_valid())
+        buffer->reset(scene, config);
+    else
+        buffer->set_output(config);
 
-    for (int sx = 0; sx < sub; ++sx)
-    {
-        const float x = float((sx + .5f) / subd) / w + pixel_x;
+    scene->update_acceleration_structure();
 
-        for (int sy = 0; sy < sub; ++sy)
+    tile_scheduler scheduler(w, h, config.tile_size, config.tile_ordering);
+    render_progress tracker = create_progress(config, h, 1);
+    const auto total_timer = std::chrono::high_resolution_clock::now();
+    const camera frame_camera(config.camera, w, h);
+    const int packet_size = packet_size_of(config.packet_mode);
+    // every pass renders the next sample index, so that the first N passes trace the same rays as a regular render of N samples
+    const int sample = buffer->sample_count();
+    const size_t subpixel_count = config.subpixels_per_pixel * config.subpixels_per_pixel;
+
+    if (progress)
+        *progress = 0;
+
+    scheduler.run(tracker.worker_count(), [&](const tile& tile, const int worker)
+    {
+        sample_tile(scene, config, frame_camera, tile, packet_size, sample, every_pixel, [&](const size_t index, const ARGB& color)
         {
-            const float y = float((sy + .5f) / subd) / w + pixel_y;
-            const auto start = std::chrono::high_resolution_clock::now();
+            buffer->add(tile.x + index % tile.width + (tile.y + index / tile.width) * size_t(w), color);
+        });
 
-            ray_trace_result result;
-            const ray3 ray = CreateRay3(config, w, h, x, y);
-            const ray_trace_iteration iteration = TraceRay3(scene, config, &result, ray);
-            const std::chrono::nanoseconds elapsed = std::chrono::high_resolution_clock::now() - start;
-            const bool is_hit = iteration.hit.type != hit_test::hit_type::no_hit;
-            ARGB color = ARGB();
+        tracker.advance(worker, tile.pixel_count() * subpixel_count);
+        publish_progress(progress, tracker, worker);
+    });
 
-            switch (config.mode)
-            {
-                case render_mode::depths:
-                    if (is_hit)
-                        color = ARGB(1.f / (1 + .25f * iteration.hit.distance));
-
-                    break;
-                case render_mode::wireframe:
-                    if (is_hit)
-                    {
-                        const float u = iteration.hit.uv.X;
-                        const float v = iteration.hit.uv.Y;
-                        const float w = 1 - u - v;
-                        const int h = std::min(w, std::min(u, v)) <= .01;
-
-                        color = ARGB(h * u, h * v, h * w);
-                    }
-
-                    break;
-                case render_mode::uv_coords:
-                    if (is_hit)
-                    {
-                        const float u = iteration.hit.uv.X;
-                        const float v = iteration.hit.uv.Y;
-
-                        color = ARGB(u, v, 1 - u - v);
-                    }
-
-                    break;
-                case render_mode::surface_normals:
-                    if (is_hit)
-                        color = iteration.surface_normal.add(vec3(1)).scale(.5f);
-
-                    break;
-                case render_mode::ray_direction:
-                    color = ray.direction.add(vec3(1)).scale(.5f);
-
-                    break;
-                case render_mode::ray_incidence_angle:
-                    if (is_hit)
-                        color = ARGB(1 - std::abs(ray.direction.angle_to(iteration.surface_normal) / ROT_90));
-
-                    break;
-                case render_mode::iterations:
-                    color = ARGB(1.f - result.size() / float(config.maximum_iteration_count));
-
-                    break;
-                case render_mode::render_time:
-                {
-                    const float µs = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    if (progress)
+        *progress = tracker.fraction();
 
-                    color = ARGB(std::log10(µs) * .30293575075f);
-                } break;
-                case render_mode::hit_type:
-                    color = iteration.hit.type == hit_test::hit_type::no_hit ? ARGB::RED :
-                            iteration.hit.type == hit_test::hit_type::tangential_hit ? ARGB::BLUE : ARGB::GREEN;
+    buffer->complete_pass();
 
-                    break;
-                case render_mode::realistic_colors:
-                case render_mode::diffuse_colors:
-                default:
-                    color = iteration.computed_color;
+    const auto elapsed = std::chrono::high_resolution_clock::now() - total_timer;
 
-                    break;
-            }
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
 
-            total = total + color * norm_factor;
-        }
-    }
+void ray_tracer_3d::ResolveAccumulationBuffer3(const accumulation_buffer* const __restrict accumulation, void* const __restrict buffer)
+{
+    assert(accumulation != nullptr && buffer != nullptr);
+
+    const render_configuration& config = accumulation->configuration();
+    const pixel_encoder encoder(config.output_format, config.tonemap, config.exposure);
+    const size_t w = config.horizontal_resolution;
+
+    parallel_for(size_t(0), size_t(config.vertical_resolution), [&](const size_t y)
+    {
+        thread_local std::vector<ARGB> colors;
+
+        colors.resize(w);
+
+        for (size_t x = 0; x < w; ++x)
+            colors[x] = accumulation->resolve(x + y * w);
 
-    buffer[index] = buffer[index] + total / float(config.samples_per_subpixel);
+        encoder.encode(colors.data(), w, static_cast<char*>(buffer) + y * w * encoder.pixel_size());
+    });
 }
 
-ray3 ray_tracer_3d::CreateRay3(const render_configuration& config, const float w, const float h, const float x, const float y)
+void ray_tracer_3d::ComputeRenderPass3(const scene* const scene, const render_configuration& config, const int raw_x, const int raw_y, ARGB* const buffer, const bool clear, const int sample)
 {
-    const float fov = M_PI_2 / config.camera.zoom_factor;
-    const vec3 gaze = config.camera.look_at.sub(config.camera.position).normalize();
-    const vec3 up = vec3::UnitY;
-    const vec3 camx = gaze.cross(up).normalize().scale(w * fov / h);
-    const vec3 camy = camx.cross(gaze).normalize().scale(fov);
-    const float dx = 2 * float_RAND / w;
-    const float dy = 2 * float_RAND / h;
-    const vec3 dir = gaze.add(camx.scale(x + dx))
-                         .add(camy.scale(y + dy))
-                         .normalize();
+    const size_t index = raw_x + size_t(raw_y) * config.horizontal_resolution;
+    const ARGB color = sample_pixel(scene, config, camera(config.camera, config.horizontal_resolution, config.vertical_resolution), raw_x, raw_y, sample);
 
-    ray3 r(config.camera.position + dir.scale(config.camera.focal_length), dir, 0, config.air_refraction_index, false);
+    if (clear)
+        buffer[index] = config.background_color;
 
-    return r;
+    buffer[index] += color / float(config.samples_per_subpixel);
 }
 
-ray_trace_iteration ray_tracer_3d::TraceRay3(const scene* const __restrict scene, const render_configuration& config, ray_trace_result* const __restrict result, const ray3& ray)
+void ray_tracer_3d::ComputeRenderPacket3(const scene* const scene, const render_configuration& config, const int raw_x, const int raw_y, const int packet_w, const int packet_h, ARGB* const buffer, const bool clear, const int sample)
 {
-    if (ray.iteration_depth < config.maximum_iteration_count)
-    {
-        // int iter_index = result->size();
+    ARGB colors[ray_packet::MAX_SIZE];
 
-        hit_test local_hit = hit_test();
-        ray_trace_iteration iteration = ray_trace_iteration();
+    sample_packet(scene, config, camera(config.camera, config.horizontal_resolution, config.vertical_resolution), raw_x, raw_y, packet_w, packet_h, colors, sample);
 
-        iteration.ray = ray;
-        iteration.hit = hit_test();
-        iteration.hit.distance = INFINITY;
-        iteration.primitive = nullptr;
+    for (int i = 0; i < packet_w * packet_h; ++i)
+    {
+        const size_t index = raw_x + i % packet_w + size_t(raw_y + i / packet_w) * config.horizontal_resolution;
 
-        for (int i = 0, l = scene->mesh.size(); i < l; ++i)
-        {
-            primitive* const primitive = scene->mesh[i];
+        if (clear)
+            buffer[index] = config.background_color;
 
-            primitive->intersect(ray, &local_hit);
+        buffer[index] += colors[i] / float(config.samples_per_subpixel);
+    }
+}
 
-            if (local_hit.distance < iteration.hit.distance)
-            {
-                iteration.hit = local_hit;
-                iteration.primitive = primitive;
-                iteration.intersection_point = iteration.ray(local_hit.distance);
-                iteration.surface_normal = primitive->normal_at(iteration.intersection_point);
-            }
-        }
+ray3 ray_tracer_3d::CreateRay3(const render_configuration& config, const float w, const float h, const float x, const float y, pcg32* const rng)
+{
+    return create_primary_ray(config, camera(config.camera, w, h), w, h, x, y, rng);
+}
 
-        if (iteration.hit.type != hit_test::hit_type::no_hit && iteration.hit.distance < INFINITY)
-            ComputeColor3(scene, config, &iteration);
-        else
-            iteration.computed_color = config.background_color;
+ray_trace_iteration ray_tracer_3d::TraceRay3(const scene* const __restrict scene, const render_configuration& config, ray_trace_result* const __restrict result, const ray3& ray, const float throughput, pcg32* const rng)
+{
+    if (ray.iteration_depth < config.maximum_iteration_count)
+    {
+        hit_test hit = hit_test();
+        primitive* primitive = nullptr;
+
+        hit.distance = INFINITY;
 
-        result->push_back(iteration);
+        scene->intersect(ray, &hit, &primitive);
 
-        return iteration;
+        return complete_iteration(scene, config, result, ray, hit, primitive, throughput, rng);
     }
 
     return ray_trace_iteration();
 }
 
-void ray_tracer_3d::ComputeColor3(const scene* const __restrict scene, const render_configuration& config, ray_trace_iteration* const __restrict iteration)
+void ray_tracer_3d::ComputeColor3(const scene* const __restrict scene, const render_configuration& config, ray_trace_result* const __restrict result, ray_trace_iteration* const __restrict iteration, const float throughput, pcg32* const rng)
 {
-    const material& mat = iteration->primitive->material;
+    const material& mat = scene->material_at(iteration->hit);
     const vec3& normal = iteration->surface_normal;
 
     if (config.mode == render_mode::realistic_colors)
     {
+        const ray3& ray = iteration->ray;
+        const vec3& point = iteration->intersection_point;
+        const bool is_exiting = ray.direction.dot(normal) > 0;
+        // the normal on the side of the incoming ray
+        const vec3 facing = (is_exiting ? -normal : normal).normalize();
+        // shadow rays start on the side of the incoming ray, so that they do not hit the surface itself
+        const vec3 shadow_origin = point + facing * SECONDARY_RAY_OFFSET;
         ARGB diffuse = ARGB::TRANSPARENT;
         ARGB specular = ARGB::TRANSPARENT;
 
         // LAMBERT DIFFUSE SHADING
         for (const light& light : scene->lights)
             if (light.mode == light::light_mode::Global)
-                diffuse = diffuse + mat.DiffuseColor * (light.diffuse_color * light.diffuse_intensity);
+                diffuse += mat.DiffuseColor * (light.diffuse_color * light.diffuse_intensity);
             else if (light.mode == light::light_mode::Parallel)
             {
+                // parallel light comes from infinitely far away against its direction
+                if (scene->occluded(ray3(shadow_origin, -light.direction), INFINITY))
+                    continue;
+
                 const float intensity = light.diffuse_intensity * light.direction.angle_to(normal);
 
                 if (intensity > 0)
-                    diffuse = diffuse + (mat.DiffuseColor * (light.diffuse_color * intensity));
+                    diffuse += mat.DiffuseColor * (light.diffuse_color * intensity);
             }
             else if (light.mode == light::light_mode::Spot)
             {
+                const float distance = light.position.distance_to(shadow_origin);
+
+                if (scene->occluded(ray3(shadow_origin, light.position - shadow_origin), distance))
+                    continue;
+
                 const float dist_sq = std::pow(light.position.distance_to(iteration->intersection_point), 2);
 
                 if (light.diffuse_intensity > 0)
@@ -308,9 +1037,38 @@ void ray_tracer_3d::ComputeColor3(const scene* const __restrict scene, const ren
 
         iteration->computed_color = diffuse;
 
+        const float reflectiveness = std::clamp(mat.Reflectiveness, 0.f, 1.f);
+        const float refractiveness = std::clamp(mat.Refractiveness, 0.f, 1.f - reflectiveness);
+
+        if (reflectiveness > 0 || refractiveness > 0)
+        {
+            float reflected_weight = reflectiveness;
+            ARGB color = diffuse * (1 - reflectiveness - refractiveness);
+
+            if (refractiveness > 0)
+            {
+                const ARGB& index = mat.RefractiveIndex;
+                const float material_index = (index.R + index.G + index.B) / 3;
+                const float next_index = is_exiting ? config.air_refraction_index : material_index > 0 ? material_index : 1.f;
+                bool total_reflection = false;
+                const vec3 direction = ray.direction.refract(facing, ray.current_refraction_index / next_index, &total_reflection);
+
+                // totally reflected light adds to the reflection instead
+                if (total_reflection)
+                    reflected_weight += refractiveness;
+                else
+                    color += trace_secondary_ray(scene, config, result, ray3(point - facing * SECONDARY_RAY_OFFSET, direction, ray.iteration_depth + 1, next_index, !is_exiting), refractiveness, throughput, rng);
+            }
+
+            if (reflected_weight > 0)
+            {
+                const vec3 direction = (-ray.direction).reflect(facing);
+
+                color += trace_secondary_ray(scene, config, result, ray3(point + facing * SECONDARY_RAY_OFFSET, direction, ray.iteration_depth + 1, ray.current_refraction_index, ray.is_inside), reflected_weight, throughput, rng);
+            }
 
-        //Vec3 direction = iteration->Ray.Direction.reflect(iteration->SurfaceNormal);
-        //RayTraceIteration i1 = TraceRay(scene, config, result, ray.create_next(distance, direction));
+            iteration->computed_color = color;
+        }
     }
     else if (config.mode == render_mode::diffuse_colors)
         iteration->computed_color = mat.DiffuseColor;
@@ -1,6 +1,11 @@
 ﻿#pragma once
 
-#include "scene.hpp"
+#include "scene_file.hpp"
+#include "mesh_importer.hpp"
+#include "camera.hpp"
+#include "render_progress.hpp"
+#include "../rng.hpp"
+#include "../pixel_encoder.hpp"
 
 
 namespace ray_tracer_3d
@@ -21,12 +26,21 @@ namespace ray_tracer_3d
         render_time,
     };
 
-    struct camera_configuration
+    // secondary rays start this far off the surface they are spawned from, so that they do not hit it again due to rounding
+    static constexpr float SECONDARY_RAY_OFFSET = 1e-4f;
+    // secondary rays of paths whose throughput drops below this value are subject to russian roulette
+    static constexpr float RUSSIAN_ROULETTE_THRESHOLD = .1f;
+    // samples every pixel receives before adaptive sampling first tests it for convergence, unless configured otherwise
+    static constexpr size_t ADAPTIVE_MINIMUM_SAMPLES = 8;
+    // pixels which have not converged after 'samples_per_subpixel' samples receive the samples saved on the converged pixels of their tile, but at most
+    // this multiple of 'samples_per_subpixel' in total
+    static constexpr size_t ADAPTIVE_MAXIMUM_SAMPLE_FACTOR = 4;
+
+    enum ray_packet_mode
     {
-        vec3 position;
-        vec3 look_at;
-        float zoom_factor;
-        float focal_length;
+        single_rays,
+        packets_2x2,
+        packets_4x4,
     };
 
     struct render_configuration
@@ -41,6 +55,30 @@ namespace ray_tracer_3d
         bool debug;
         ARGB background_color;
         float air_refraction_index;
+        // traces the primary rays of each pixel block as one coherent packet. secondary rays are always traced on their own.
+        ray_packet_mode packet_mode;
+        // edge length of the square tiles handed out to the render threads (in pixels). zero selects 'tile_scheduler::DEFAULT_TILE_SIZE'.
+        size_t tile_size;
+        tile_order tile_ordering;
+        // number of render threads. zero uses all hardware threads.
+        size_t thread_count;
+        // seed of the sample jitter. the same seed always produces the same image, regardless of the thread count.
+        size_t seed;
+        // records every traced iteration into the 'ray_trace_result' (for debugging). this is off by default, which keeps the trace path free of allocations.
+        bool record_history;
+        // adaptive sampling stops sampling a pixel as soon as the standard error of its mean luminance drops below this value (relative to the luminance
+        // for pixels brighter than one). the samples saved this way are spent on the pixels of the same tile which are still noisy after
+        // 'samples_per_subpixel' samples (see ADAPTIVE_MAXIMUM_SAMPLE_FACTOR), so that a tile never traces more samples than without adaptive sampling.
+        // zero disables adaptive sampling.
+        float adaptive_threshold;
+        // number of samples traced for every pixel before its convergence is first tested. zero selects ADAPTIVE_MINIMUM_SAMPLES.
+        size_t adaptive_minimum_samples;
+        // pixel layout of the output buffer of 'RenderImage3', 'StartRender3' and 'ResolveAccumulationBuffer3'.
+        framebuffer_format output_format;
+        // tone mapping applied while the samples are resolved into the output buffer.
+        tonemap_operator tonemap;
+        // exposure in stops, by which the colors are scaled before tone mapping. zero leaves them unscaled.
+        float exposure;
     };
 
     struct ray_trace_iteration
@@ -50,7 +88,9 @@ namespace ray_tracer_3d
         ARGB computed_color;
         vec3 surface_normal;
         vec3 intersection_point;
-        primitive* primitive;
+        // the hit's UV coordinates, or the interpolated texture coordinates of meshes which have them
+        vec2 texture_coordinates;
+        ray_tracer_3d::primitive* primitive;
 
 
         TO_STRING(ray_trace_iteration, "R=" << ray
@@ -61,14 +101,254 @@ namespace ray_tracer_3d
                                     << ",P=" << (primitive ? primitive->to_string() : "[null]"));
     };
 
-    typedef std::vector<ray_trace_iteration> ray_trace_result;
+    // Iterations traced for one sample. Only their number is kept by default, as the renderer itself does not need more. The full iteration history is
+    // recorded only if requested through 'render_configuration::record_history', into storage that is bounded by 'maximum_iteration_count' and kept across
+    // samples. A result reused for every sample of a render thread therefore never allocates once its storage has been reserved.
+    class ray_trace_result
+    {
+        std::vector<ray_trace_iteration> _history;
+        size_t _count = 0;
+        size_t _capacity = 0;
+        bool _record_history = false;
+
+    public:
+        ray_trace_result() noexcept = default;
+
+        ray_trace_result(const size_t capacity, const bool record_history) noexcept
+        {
+            reset(capacity, record_history);
+        }
+
+        // Prepares the result for a new sample.
+        inline void reset(const size_t capacity, const bool record_history) noexcept
+        {
+            _history.clear();
+            _count = 0;
+            _capacity = capacity;
+            _record_history = record_history;
+
+            if (record_history && _history.capacity() < capacity)
+                _history.reserve(capacity);
+        }
+
+        inline void push_back(const ray_trace_iteration& iteration) noexcept
+        {
+            if (_record_history && _history.size() < _capacity)
+                _history.push_back(iteration);
+
+            ++_count;
+        }
+
+        // number of traced iterations, regardless of whether they have been recorded
+        inline size_t size() const noexcept
+        {
+            return _count;
+        }
+
+        inline const std::vector<ray_trace_iteration>& history() const noexcept
+        {
+            return _history;
+        }
+
+        TO_STRING(ray_trace_result, "Count=" << _count << ",Recorded=" << _history.size());
+    };
+
+    // Running per-pixel sums of a progressively rendered image. Every progressive pass adds one sample to each pixel, and 'resolve' divides the sums by
+    // the number of completed passes. The sums are kept in double precision, so that thousands of passes can be accumulated without visible rounding.
+    // The buffer remembers the id and revision of the scene and the configuration it was rendered with, and is reset as soon as a pass is requested for
+    // a different frame.
+    // Resetting is cheap, as the first pass after a reset overwrites the sums instead of clearing them beforehand.
+    class accumulation_buffer
+    {
+        std::vector<double> _sums;
+        size_t _sample_count = 0;
+        // 0 until the first reset, as scene ids start at 1
+        size_t _scene_id = 0;
+        size_t _scene_revision = 0;
+        render_configuration _config = render_configuration();
+
+    public:
+        inline size_t sample_count() const noexcept
+        {
+            return _sample_count;
+        }
+
+        inline size_t pixel_count() const noexcept
+        {
+            return _sums.size() / 4;
+        }
+
+        inline const render_configuration& configuration() const noexcept
+        {
+            return _config;
+        }
+
+        // Returns whether the given scene and configuration produce the same image as the accumulated passes. Settings which do not change the image
+        // (e.g. the thread count or the tile order) are ignored.
+        bool is_same_frame(const scene* const scene, const render_configuration& config) const noexcept;
+
+        // Discards all accumulated passes and prepares the buffer for the given frame.
+        void reset(const scene* const scene, const render_configuration& config) noexcept;
+
+        // Discards all accumulated passes of the current frame.
+        inline void reset() noexcept
+        {
+            _sample_count = 0;
+        }
+
+        // Takes over the output format, the tone mapping and the exposure of the given configuration, which only affect 'ResolveAccumulationBuffer3'.
+        inline void set_output(const render_configuration& config) noexcept
+        {
+            _config.output_format = config.output_format;
+            _config.tonemap = config.tonemap;
+            _config.exposure = config.exposure;
+        }
+
+        // Adds the color of the current pass to the given pixel. Different pixels may be added concurrently.
+        inline void add(const size_t index, const ARGB& color) noexcept
+        {
+            double* const sum = _sums.data() + index * 4;
+
+            if (_sample_count)
+            {
+                sum[0] += color.A;
+                sum[1] += color.R;
+                sum[2] += color.G;
+                sum[3] += color.B;
+            }
+            else
+            {
+                sum[0] = color.A;
+                sum[1] = color.R;
+                sum[2] = color.G;
+                sum[3] = color.B;
+            }
+        }
+
+        // Marks the current pass as completed, after 'add' has been called for every pixel.
+        inline void complete_pass() noexcept
+        {
+            ++_sample_count;
+        }
+
+        // Returns the mean of all completed passes of the given pixel on top of the background color, as a regular render of as many samples would.
+        inline ARGB resolve(const size_t index) const noexcept
+        {
+            if (!_sample_count)
+                return ARGB::TRANSPARENT;
+
+            const double* const sum = _sums.data() + index * 4;
+            const double factor = 1. / _sample_count;
+
+            return _config.background_color + ARGB(float(sum[0] * factor), float(sum[1] * factor), float(sum[2] * factor), float(sum[3] * factor));
+        }
+
+        TO_STRING(accumulation_buffer, "Pixels=" << pixel_count() << ",Samples=" << _sample_count);
+    };
+
+
+    enum render_job_state
+    {
+        running,
+        completed,
+        cancelled,
+    };
+
+    // Render started asynchronously through 'StartRender3'. The render runs on its own thread, which distributes the tiles to the task pool as 'RenderImage3'
+    // does. Cancellation is checked before every tile and between the samples of a tile, so a cancelled job returns within a few milliseconds.
+    class render_job
+    {
+        std::atomic<bool> _cancellation_requested = false;
+        std::atomic<render_job_state> _state = render_job_state::running;
+        render_progress _progress;
+        // declared last, as the render thread started by its initialization uses all other members
+        std::future<float> _result;
+
+    public:
+        render_job(const scene* const scene, const render_configuration& config, void* const buffer) noexcept;
+
+        inline void cancel() noexcept
+        {
+            _cancellation_requested = true;
+        }
+
+        inline const render_progress& progress() const noexcept
+        {
+            return _progress;
+        }
+
+        inline render_job_state state() const noexcept
+        {
+            return _state;
+        }
+
+        // Blocks until the render has finished and returns its render time in microseconds, or a negative value if it has been cancelled.
+        // This may only be called once.
+        inline float wait() noexcept
+        {
+            return _result.get();
+        }
+
+        TO_STRING(render_job, "Progress=" << _progress.fraction() << ",State=" << _state);
+    };
 
 
-    extern "C" __declspec(dllexport) scene* __cdecl CreateScene3();
-    extern "C" __declspec(dllexport) void __cdecl DeleteScene3(scene* const);
-    extern "C" __declspec(dllexport) float __cdecl RenderImage3(const scene* const __restrict, render_configuration const, ARGB* const __restrict, float* const __restrict = nullptr);
-    extern "C" __declspec(dllexport) void __cdecl ComputeRenderPass3(const scene* const, const render_configuration&, const int, const int, ARGB* const&, const bool = true);
-    extern "C" __declspec(dllexport) inline ray3 __cdecl CreateRay3(const render_configuration&, const float, const float, const float, const float);
-    extern "C" __declspec(dllexport) inline ray_trace_iteration __cdecl TraceRay3(const scene* const __restrict, const render_configuration&, ray_trace_result* const __restrict, const ray3&);
-    extern "C" __declspec(dllexport) inline void __cdecl ComputeColor3(const scene* const __restrict, const render_configuration&, ray_trace_iteration* const __restrict);
+    extern "C" DLL_EXPORT scene* CDECL CreateScene3();
+    extern "C" DLL_EXPORT void CDECL DeleteScene3(scene* const);
+    // Loads a scene file in text or binary form (see 'scene_file.hpp'). Returns null and reports the problem on stderr if the file cannot be loaded.
+    extern "C" DLL_EXPORT scene* CDECL LoadScene3(const char* const);
+    // Writes the scene to a file in binary form. Returns false and reports the problem on stderr if the file cannot be written.
+    extern "C" DLL_EXPORT bool CDECL SaveScene3(const scene* const, const char* const);
+    // Imports an OBJ or binary PLY mesh (see 'mesh_importer.hpp') into the scene with a white diffuse material. The acceleration structure must be rebuilt
+    // afterwards. Returns false and reports the problem on stderr if the file cannot be imported.
+    extern "C" DLL_EXPORT bool CDECL ImportMesh3(scene* const, const char* const);
+    // Imports an OBJ or binary PLY mesh as a mesh asset with a white diffuse material, which instances can place any number of times (see 'mesh_instance').
+    // Returns the index of the asset, or ~0u and reports the problem on stderr if the file cannot be imported.
+    extern "C" DLL_EXPORT uint CDECL AddMeshAsset3(scene* const, const char* const);
+    // Places the asset with the given index through a row-major 3x4 affine transform (12 floats). The material override is an index into the scene's
+    // material table, or ~0u to keep the asset's materials. The acceleration structure must be rebuilt afterwards. Returns false if the asset index or the
+    // material override is out of range, or if the transform is not invertible.
+    extern "C" DLL_EXPORT bool CDECL AddInstance3(scene* const __restrict, const uint, const float* const __restrict, const uint);
+    extern "C" DLL_EXPORT float CDECL RebuildScene3(scene* const);
+    extern "C" DLL_EXPORT float CDECL RefitScene3(scene* const);
+    // Returns the number of materials in the scene's material table (see 'scene::materials').
+    extern "C" DLL_EXPORT size_t CDECL GetMaterialCount3(const scene* const);
+    // Copies the material with the given index. Returns false if the index is out of range.
+    extern "C" DLL_EXPORT bool CDECL GetMaterial3(const scene* const __restrict, const uint, material* const __restrict);
+    // Replaces the material with the given index, which changes all primitives using it without touching the geometry. Must not be called while the
+    // scene is being rendered. Returns false if the index is out of range.
+    extern "C" DLL_EXPORT bool CDECL SetMaterial3(scene* const, const uint, const material);
+    // Renders the image into 'buffer', whose pixels have the layout given by 'render_configuration::output_format'. Every tile accumulates its samples in
+    // a small float buffer of its own and is tone mapped and encoded into 'buffer' once it is finished, so compact formats never pass through float pixels.
+    extern "C" DLL_EXPORT float CDECL RenderImage3(const scene* const __restrict, render_configuration const, void* const __restrict, float* const __restrict = nullptr);
+    // Renders 'row_count' rows of the image, starting at 'first_row', into 'buffer', which only holds these rows. The rows are identical to the same rows of
+    // the whole image, so that large images can be rendered and written out in bands without ever holding the whole image in memory.
+    extern "C" DLL_EXPORT float CDECL RenderRows3(const scene* const __restrict, render_configuration const, const size_t, const size_t, void* const __restrict, float* const __restrict = nullptr);
+    // Starts rendering the image into 'buffer' in the background. The buffer must stay valid until the job has been released through 'WaitRender3'.
+    // The acceleration structure is brought up to date on the calling thread before the job starts. The scene must not be edited, rebuilt or refitted
+    // while any job rendering it is running, which includes cancelled jobs that have not been released through 'WaitRender3' yet.
+    extern "C" DLL_EXPORT render_job* CDECL StartRender3(const scene* const __restrict, render_configuration const, void* const __restrict);
+    extern "C" DLL_EXPORT render_job_state CDECL PollRender3(const render_job* const __restrict, float* const __restrict = nullptr);
+    // Requests the job to stop as soon as possible. The job must still be released through 'WaitRender3'.
+    extern "C" DLL_EXPORT void CDECL CancelRender3(render_job* const);
+    // Copies the job's bitmap of finished tiles (see 'render_progress::completed_tiles') and returns the number of finished tiles.
+    extern "C" DLL_EXPORT size_t CDECL GetCompletedTiles3(const render_job* const __restrict, unsigned long long* const __restrict, const size_t);
+    // Returns the tile size and the number of tile columns and rows of the job, which the bitmap of finished tiles refers to.
+    extern "C" DLL_EXPORT void CDECL GetTileGrid3(const render_job* const __restrict, int* const __restrict, int* const __restrict, int* const __restrict);
+    // Waits for the job to finish, releases it and returns its render time in microseconds (negative if it has been cancelled).
+    extern "C" DLL_EXPORT float CDECL WaitRender3(render_job* const);
+    extern "C" DLL_EXPORT accumulation_buffer* CDECL CreateAccumulationBuffer3();
+    extern "C" DLL_EXPORT void CDECL DeleteAccumulationBuffer3(accumulation_buffer* const);
+    extern "C" DLL_EXPORT void CDECL ResetAccumulationBuffer3(accumulation_buffer* const);
+    extern "C" DLL_EXPORT size_t CDECL GetAccumulatedSampleCount3(const accumulation_buffer* const);
+    extern "C" DLL_EXPORT float CDECL RenderProgressive3(const scene* const __restrict, render_configuration const, accumulation_buffer* const __restrict, float* const __restrict = nullptr);
+    // Resolves the accumulated mean of every pixel into 'buffer', using the output format and tone mapping of the configuration the buffer accumulates.
+    extern "C" DLL_EXPORT void CDECL ResolveAccumulationBuffer3(const accumulation_buffer* const __restrict, void* const __restrict);
+    // Adds the given sample of the pixel (or packet of pixels) to 'buffer', weighted by the inverse sample count. 'clear' first resets the pixels to the
+    // background color, as for the first sample.
+    extern "C" DLL_EXPORT void CDECL ComputeRenderPass3(const scene* const, const render_configuration&, const int, const int, ARGB* const, const bool = true, const int = 0);
+    extern "C" DLL_EXPORT void CDECL ComputeRenderPacket3(const scene* const, const render_configuration&, const int, const int, const int, const int, ARGB* const, const bool = true, const int = 0);
+    extern "C" DLL_EXPORT ray3 CDECL CreateRay3(const render_configuration&, const float, const float, const float, const float, pcg32* const = nullptr);
+    extern "C" DLL_EXPORT ray_trace_iteration CDECL TraceRay3(const scene* const __restrict, const render_configuration&, ray_trace_result* const __restrict, const ray3&, const float = 1.f, pcg32* const = nullptr);
+    extern "C" DLL_EXPORT void CDECL ComputeColor3(const scene* const __restrict, const render_configuration&, ray_trace_result* const __restrict, ray_trace_iteration* const __restrict, const float = 1.f, pcg32* const = nullptr);
 };
\ No newline at end of file
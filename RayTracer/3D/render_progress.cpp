@@ -0,0 +1,50 @@
+#include "render_progress.hpp"
+
+using namespace ray_tracer_3d;
+
+
+ray_tracer_3d::render_progress::render_progress(const int width, const int height, const int tile_size, const int worker_count, const size_t total) noexcept
+    : _worker_count(std::max(worker_count, 1))
+    , _tile_size(tile_size > 0 ? tile_size : tile_scheduler::DEFAULT_TILE_SIZE)
+    , _total(total)
+{
+    _columns = (std::max(width, 0) + _tile_size - 1) / _tile_size;
+    _rows = (std::max(height, 0) + _tile_size - 1) / _tile_size;
+    _counters.reset(new worker_counter[_worker_count]);
+    _completed_tiles.reset(new std::atomic<unsigned long long>[word_count()]);
+
+    for (int worker = 0; worker < _worker_count; ++worker)
+        _counters[worker].value.store(0, std::memory_order_relaxed);
+
+    for (size_t word = 0; word < word_count(); ++word)
+        _completed_tiles[word].store(0, std::memory_order_relaxed);
+}
+
+float ray_tracer_3d::render_progress::fraction() const noexcept
+{
+    if (!_total)
+        return 1.f;
+
+    size_t completed = 0;
+
+    for (int worker = 0; worker < _worker_count; ++worker)
+        completed += _counters[worker].value.load(std::memory_order_relaxed);
+
+    return std::min(1.f, float(completed) / _total);
+}
+
+size_t ray_tracer_3d::render_progress::completed_tiles(unsigned long long* const bitmap, const size_t word_count) const noexcept
+{
+    const size_t count = std::min(word_count, this->word_count());
+    size_t completed = 0;
+
+    for (size_t word = 0; word < count; ++word)
+    {
+        bitmap[word] = _completed_tiles[word].load(std::memory_order_acquire);
+
+        for (unsigned long long bits = bitmap[word]; bits; bits &= bits - 1)
+            ++completed;
+    }
+
+    return completed;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "tile_scheduler.hpp"
+
+
+namespace ray_tracer_3d
+{
+    // Progress of a render, which the render workers report and the host may read at any time.
+    // Every worker counts its completed work in a counter on a cache line of its own, which no other thread ever writes. The counters are only summed up when
+    // the progress is queried ('fraction'), so reporting never contends, and as every counter only grows, successive queries never report less progress.
+    // Finished tiles are additionally flagged in a bitmap over the row-major tile grid, from which the host can tell which pixels are final.
+    class render_progress
+    {
+        struct alignas(64) worker_counter
+        {
+            std::atomic<size_t> value;
+        };
+
+        std::unique_ptr<worker_counter[]> _counters;
+        std::unique_ptr<std::atomic<unsigned long long>[]> _completed_tiles;
+        int _worker_count = 0;
+        int _tile_size = 0;
+        int _columns = 0;
+        int _rows = 0;
+        size_t _total = 0;
+
+    public:
+        render_progress() noexcept = default;
+
+        // Creates the progress of a render of width x height pixels in tiles of 'tile_size' pixels (zero selects the default), whose workers complete 'total' units of work.
+        render_progress(const int width, const int height, const int tile_size, const int worker_count, const size_t total) noexcept;
+
+        inline int worker_count() const noexcept
+        {
+            return _worker_count;
+        }
+
+        inline int tile_size() const noexcept
+        {
+            return _tile_size;
+        }
+
+        inline int columns() const noexcept
+        {
+            return _columns;
+        }
+
+        inline int rows() const noexcept
+        {
+            return _rows;
+        }
+
+        // number of 64 bit words of the completed tile bitmap
+        inline size_t word_count() const noexcept
+        {
+            return (size_t(_columns) * _rows + 63) / 64;
+        }
+
+        // Adds 'amount' units of completed work to the counter of the given worker. This may only be called by the worker itself.
+        inline void advance(const int worker, const size_t amount) noexcept
+        {
+            std::atomic<size_t>& counter = _counters[worker].value;
+
+            // the counter has a single writer, so no read-modify-write operation is needed
+            counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+
+        // Flags the given tile as finished. All pixels written before are visible to a host which observes the flag.
+        inline void complete(const tile& tile) noexcept
+        {
+            const size_t index = size_t(tile.y / _tile_size) * _columns + tile.x / _tile_size;
+
+            _completed_tiles[index / 64].fetch_or(1ull << (index % 64), std::memory_order_release);
+        }
+
+        // Returns the completed fraction of the work in [0, 1].
+        float fraction() const noexcept;
+
+        // Copies up to 'word_count' words of the completed tile bitmap, in which bit (row * columns + column) stands for the tile at pixel
+        // (column * tile_size, row * tile_size). Returns the number of completed tiles.
+        size_t completed_tiles(unsigned long long* const bitmap, const size_t word_count) const noexcept;
+
+        TO_STRING(render_progress, "Workers=" << _worker_count << ",Tiles=" << _columns << "x" << _rows << ",Progress=" << fraction());
+    };
+};
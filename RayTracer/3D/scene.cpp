@@ -1,8 +1,12 @@
 #include "scene.hpp"
+#include "../task_pool.hpp"
 
 using namespace ray_tracer_3d;
 
 
+std::atomic<size_t> ray_tracer_3d::scene::last_id = 0;
+
+
 int ray_tracer_3d::mesh_reference::shape_count() const noexcept
 {
     return _indices.size();
@@ -14,7 +18,7 @@ std::vector<primitive*> ray_tracer_3d::mesh_reference::mesh() const noexcept
     std::vector<primitive*> shapes;
 
     for (const int index : _indices)
-        if (index > 0 && index < mesh.size())
+        if (index >= 0 && index < mesh.size())
             shapes.push_back(mesh[index]);
 
     return shapes;
@@ -26,18 +30,228 @@ float ray_tracer_3d::mesh_reference::surface_area() const
     float area = 0;
 
     for (const int index : _indices)
-        if (index > 0 && index < mesh.size())
+        if (index >= 0 && index < mesh.size())
             area += mesh[index]->surface_area();
 
     return area;
 }
 
 void ray_tracer_3d::mesh_reference::set_material(const material& mat) noexcept
+{
+    set_material(_scene->add_material(mat));
+}
+
+void ray_tracer_3d::mesh_reference::set_material(const uint material_index) noexcept
 {
     std::vector<primitive*> const mesh = _scene->mesh;
 
     for (const int index : _indices)
-        if (index > 0 && index < mesh.size())
-            mesh[index]->material = mat;
+        if (index >= 0 && index < mesh.size())
+            mesh[index]->material_index = material_index;
+}
+
+// Returns the bounding boxes of all primitives in the order of their indices.
+static std::vector<aabb> primitive_bounds(const scene& scene) noexcept
+{
+    std::vector<aabb> bounds(scene.primitive_count());
+
+    parallel_for(size_t(0), bounds.size(), [&](const size_t index)
+    {
+        bounds[index] = scene.bounding_box(index);
+    });
+
+    return bounds;
+}
+
+// Returns the world-space bounding boxes of all instances in the order of their indices.
+static std::vector<aabb> instance_bounds(const scene& scene) noexcept
+{
+    std::vector<aabb> bounds(scene.instances.size());
+
+    parallel_for(size_t(0), bounds.size(), [&](const size_t index)
+    {
+        bounds[index] = scene.instances[index].bounding_box();
+    });
+
+    return bounds;
+}
+
+void ray_tracer_3d::scene::rebuild_acceleration_structure() const noexcept
+{
+    instance_structure.build(instance_bounds(*this));
+
+    if (primitive_count() <= BRUTE_FORCE_THRESHOLD)
+    {
+        acceleration_structure.clear();
+        triangles.build(mesh, indexed_meshes);
+    }
+    else
+    {
+        acceleration_structure.build(primitive_bounds(*this));
+        triangles.build(mesh, indexed_meshes, acceleration_structure.primitive_indices());
+    }
+}
+
+void ray_tracer_3d::scene::refit_acceleration_structure() const noexcept
+{
+    if (!is_acceleration_structure_valid())
+        rebuild_acceleration_structure();
+    else
+    {
+        if (!acceleration_structure.is_empty())
+            acceleration_structure.refit(primitive_bounds(*this));
+
+        if (!instance_structure.is_empty())
+            instance_structure.refit(instance_bounds(*this));
+
+        triangles.update_vertices(mesh, indexed_meshes);
+    }
+}
+
+// Closest-hit test of the instances, which only reports hits closer than the result's current distance. All instances are tested one by one if the
+// instance structure is out of date.
+static bool intersect_instances(const scene& scene, const ray3& ray, hit_test* const result) noexcept
+{
+    const bool is_valid = scene.instance_structure.primitive_count() == scene.instances.size();
+    const uint* const indices = scene.instance_structure.primitive_indices().data();
+    const auto test_leaf = [&](const uint first, const uint last)
+    {
+        bool found = false;
+
+        for (uint slot = first; slot < last; ++slot)
+        {
+            const uint index = is_valid ? indices[slot] : slot;
+
+            if (scene.instances[index].intersect(ray, result))
+            {
+                result->instance_index = index;
+                found = true;
+            }
+        }
+
+        return found;
+    };
+
+    return is_valid ? scene.instance_structure.closest_hit(ray, result->distance, test_leaf) : test_leaf(0, scene.instances.size());
+}
+
+static bool instances_occlude(const scene& scene, const ray3& ray, const float max_distance) noexcept
+{
+    const bool is_valid = scene.instance_structure.primitive_count() == scene.instances.size();
+    const uint* const indices = scene.instance_structure.primitive_indices().data();
+    const auto test_leaf = [&](const uint first, const uint last)
+    {
+        for (uint slot = first; slot < last; ++slot)
+            if (scene.instances[is_valid ? indices[slot] : slot].occluded(ray, max_distance))
+                return true;
+
+        return false;
+    };
+
+    return is_valid ? scene.instance_structure.any_hit(ray, max_distance, test_leaf) : test_leaf(0, scene.instances.size());
+}
+
+bool ray_tracer_3d::scene::intersect(const ray3& ray, hit_test* const __restrict result, primitive** const __restrict hit_primitive) const noexcept
+{
+    bool found = intersect_primitives(ray, result, hit_primitive);
+
+    // instances are tested last, so that a closer instance hit replaces any primitive hit
+    if (!instances.empty() && intersect_instances(*this, ray, result))
+    {
+        *hit_primitive = nullptr;
+        found = true;
+    }
+
+    return found;
+}
+
+bool ray_tracer_3d::scene::intersect_primitives(const ray3& ray, hit_test* const __restrict result, primitive** const __restrict hit_primitive) const noexcept
+{
+    if (is_acceleration_structure_valid())
+    {
+        if (acceleration_structure.is_empty())
+            return triangles.intersect(mesh, 0, triangles.size(), ray, result, hit_primitive);
+        else
+            return acceleration_structure.intersect(mesh, triangles, ray, result, hit_primitive);
+    }
+
+    // unaccelerated fallback for meshes which have been modified since the last build. the triangles of indexed meshes are tested through temporary
+    // triangles on the stack.
+    bool found = false;
+
+    for (size_t index = 0, count = primitive_count(); index < count; ++index)
+    {
+        hit_test local_hit = hit_test();
+
+        if (index < mesh.size())
+            mesh[index]->intersect(ray, &local_hit);
+        else
+        {
+            size_t tri;
+            vec3 a, b, c;
+
+            locate_triangle(indexed_meshes, indexed_mesh_offsets, index - mesh.size(), &tri).triangle_vertices(tri, &a, &b, &c);
+            triangle(a, b, c).intersect(ray, &local_hit);
+        }
+
+        if (local_hit.type != hit_test::hit_type::no_hit && local_hit.distance < result->distance)
+        {
+            *result = local_hit;
+            result->primitive_index = index;
+            *hit_primitive = primitive_at(index);
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+bool ray_tracer_3d::scene::occluded(const ray3& ray, const float max_distance) const noexcept
+{
+    return occluded_by_primitives(ray, max_distance) || (!instances.empty() && instances_occlude(*this, ray, max_distance));
+}
+
+bool ray_tracer_3d::scene::occluded_by_primitives(const ray3& ray, const float max_distance) const noexcept
+{
+    if (is_acceleration_structure_valid())
+    {
+        if (acceleration_structure.is_empty())
+            return triangles.occluded(mesh, 0, triangles.size(), ray, max_distance);
+        else
+            return acceleration_structure.occluded(mesh, triangles, ray, max_distance);
+    }
+
+    for (const primitive* const primitive : mesh)
+        if (primitive->occludes(ray, max_distance))
+            return true;
+
+    for (const indexed_mesh& indexed : indexed_meshes)
+        for (size_t tri = 0; tri < indexed.triangle_count; ++tri)
+        {
+            vec3 a, b, c;
+
+            indexed.triangle_vertices(tri, &a, &b, &c);
+
+            if (triangle(a, b, c).occludes(ray, max_distance))
+                return true;
+        }
+
+    return false;
 }
 
+void ray_tracer_3d::scene::intersect(const ray3* const rays, const int count, hit_test* const __restrict results, primitive** const __restrict hit_primitives) const noexcept
+{
+    if (is_acceleration_structure_valid() && !acceleration_structure.is_empty())
+    {
+        acceleration_structure.intersect(mesh, triangles, ray_packet(rays, count), results, hit_primitives);
+
+        // the instances are tested ray by ray, as their object-space rays no longer form a coherent packet
+        if (!instances.empty())
+            for (int i = 0; i < count; ++i)
+                if (intersect_instances(*this, rays[i], results + i))
+                    hit_primitives[i] = nullptr;
+    }
+    else
+        for (int i = 0; i < count; ++i)
+            intersect(rays[i], results + i, hit_primitives + i);
+}
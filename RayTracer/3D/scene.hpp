@@ -1,6 +1,6 @@
 #pragma once
 
-#include "primitive3.hpp"
+#include "mesh_instance.hpp"
 
 
 namespace ray_tracer_3d
@@ -89,8 +89,12 @@ namespace ray_tracer_3d
 
         float surface_area() const;
 
+        // Appends the material to the scene's material table and assigns it to the referenced primitives.
         void set_material(const material& mat) noexcept;
 
+        // Assigns the material with the given index within the scene's material table to the referenced primitives.
+        void set_material(const uint material_index) noexcept;
+
         inline static mesh_reference empty(scene* scene) noexcept
         {
             return mesh_reference(scene, std::vector<int>());
@@ -101,16 +105,162 @@ namespace ray_tracer_3d
     {
         // static_assert(std::is_standard_layout_v<Scene>);
 
+        // meshes of up to this many primitives are intersected by brute force through the SIMD triangle kernel, as a traversal would cost more than it saves
+        static constexpr size_t BRUTE_FORCE_THRESHOLD = 32;
+        // id of the most recently created scene (see 'id')
+        static std::atomic<size_t> last_id;
+
         std::vector<primitive*> mesh;
+        // triangle meshes stored as packed arrays. their triangles are numbered after the primitives of 'mesh' (see 'primitive_count'). meshes must be
+        // added through 'add_indexed_mesh', which keeps 'indexed_mesh_offsets' up to date.
+        std::vector<indexed_mesh> indexed_meshes;
+        // index of the first triangle of every indexed mesh among the triangles of all of them, followed by their total count (see 'triangle_offsets').
+        // hits are mapped to their mesh by a binary search of these offsets.
+        std::vector<size_t> indexed_mesh_offsets;
+        // materials referenced by index from all primitives. the first one is the default of primitives which have not been assigned one. materials
+        // may be edited between renders without rebuilding the acceleration structure, as it does not depend on them.
+        std::vector<material> materials;
+        // shared geometry of the instances, each with an acceleration structure of its own
+        std::vector<std::shared_ptr<const mesh_asset>> mesh_assets;
+        // transformed placements of the mesh assets, which are intersected through 'instance_structure' rather than the primitive index space
+        std::vector<mesh_instance> instances;
         std::vector<light> lights;
+        // built lazily before the first render after the mesh has changed (see 'update_acceleration_structure')
+        mutable bvh acceleration_structure;
+        // packed copy of all triangles in the leaf order of 'acceleration_structure' (or in index order for brute-force meshes)
+        mutable triangle_store triangles;
+        // top level of the two-level hierarchy over the instances' world-space bounds. rays are transformed into object space at its leaves and then
+        // traverse the asset's own acceleration structure.
+        mutable bvh instance_structure;
+        // incremented by every edit of the scene through the exported functions (materials, meshes, instances or moved geometry), so that renders which
+        // accumulate samples across calls can tell that their samples are stale (see 'accumulation_buffer')
+        size_t revision = 0;
+        // unique among all scenes created by the process, starting at 1. unlike the scene's address, it is never reused by a scene allocated after this
+        // one has been deleted, which is what 'accumulation_buffer' identifies the scene of its samples by.
+        const size_t id;
 
 
         scene() noexcept
             : mesh(std::vector<primitive*>())
+            , indexed_mesh_offsets(1, 0)
+            , materials({ material::diffuse(ARGB::WHITE) })
             , lights(std::vector<light>())
+            , id(++last_id)
+        {
+        }
+
+        // Returns the number of primitives, which are indexed consecutively: the primitives of 'mesh' come first, followed by the triangles of every
+        // indexed mesh in turn. Acceleration structures and hit tests refer to primitives by these indices.
+        inline size_t primitive_count() const noexcept
+        {
+            return mesh.size() + indexed_mesh_offsets.back();
+        }
+
+        // Returns the primitive with the given index, or null for the triangles of indexed meshes, which only exist as packed arrays.
+        inline primitive* primitive_at(const size_t index) const noexcept
+        {
+            return index < mesh.size() ? mesh[index] : nullptr;
+        }
+
+        // Returns the index of the primitive's material within 'materials'.
+        inline uint material_index_at(const size_t index) const noexcept
+        {
+            if (index < mesh.size())
+                return mesh[index]->material_index;
+
+            size_t triangle;
+
+            return locate_triangle(indexed_meshes, indexed_mesh_offsets, index - mesh.size(), &triangle).material_index_of(triangle);
+        }
+
+        // Returns whether the hit identifies a surface of the scene, i.e. a primitive or the triangle of an instance.
+        inline bool is_surface_hit(const hit_test& hit) const noexcept
+        {
+            return hit.instance_index < instances.size() || (hit.instance_index == ~0u && hit.primitive_index < primitive_count());
+        }
+
+        // Returns the material of the hit surface, which must satisfy 'is_surface_hit'.
+        inline const material& material_at(const hit_test& hit) const noexcept
+        {
+            if (hit.instance_index != ~0u)
+                return materials[instances[hit.instance_index].material_index_at(hit)];
+
+            return materials[material_index_at(hit.primitive_index)];
+        }
+
+        // Returns the surface normal at the given hit point, whose UV coordinates as reported by the hit test are used to interpolate vertex normals.
+        inline vec3 normal_at(const hit_test& hit, const vec3& point) const noexcept
         {
+            const size_t index = hit.primitive_index;
+
+            if (hit.instance_index != ~0u)
+                return instances[hit.instance_index].normal_at(hit);
+            else if (index < mesh.size())
+                return mesh[index]->normal_at(point);
+
+            size_t triangle;
+
+            return locate_triangle(indexed_meshes, indexed_mesh_offsets, index - mesh.size(), &triangle).normal_at(triangle, hit.uv);
+        }
+
+        // Returns the texture coordinates of the hit. These are its UV coordinates, unless the hit primitive is the triangle of an indexed mesh (or
+        // instance) with texture coordinates.
+        inline vec2 texture_coordinates_at(const hit_test& hit) const noexcept
+        {
+            const size_t index = hit.primitive_index;
+
+            if (hit.instance_index != ~0u)
+                return instances[hit.instance_index].texture_coordinates_at(hit);
+            else if (index < mesh.size())
+                return hit.uv;
+
+            size_t triangle;
+
+            return locate_triangle(indexed_meshes, indexed_mesh_offsets, index - mesh.size(), &triangle).uv_at(triangle, hit.uv);
         }
 
+        inline aabb bounding_box(const size_t index) const noexcept
+        {
+            if (index < mesh.size())
+                return mesh[index]->bounding_box();
+
+            size_t triangle;
+
+            return locate_triangle(indexed_meshes, indexed_mesh_offsets, index - mesh.size(), &triangle).bounding_box(triangle);
+        }
+
+        inline bool is_acceleration_structure_valid() const noexcept
+        {
+            const size_t count = primitive_count();
+
+            return triangles.size() == count && (count <= BRUTE_FORCE_THRESHOLD || acceleration_structure.primitive_count() == count) &&
+                   instance_structure.primitive_count() == instances.size();
+        }
+
+        inline void update_acceleration_structure() const noexcept
+        {
+            if (!is_acceleration_structure_valid())
+                rebuild_acceleration_structure();
+        }
+
+        void rebuild_acceleration_structure() const noexcept;
+
+        // cheaper than a full rebuild if only the primitives' positions changed, but degrades the tree quality with larger movements
+        void refit_acceleration_structure() const noexcept;
+
+        bool intersect(const ray3& ray, hit_test* const __restrict result, primitive** const __restrict hit_primitive) const noexcept;
+
+        // Closest-hit test of the primitives (i.e. everything except the instances).
+        bool intersect_primitives(const ray3& ray, hit_test* const __restrict result, primitive** const __restrict hit_primitive) const noexcept;
+
+        // Returns whether any primitive or instance is hit closer than 'max_distance' along the ray. Used for shadow rays, which only need to know whether anything blocks the light.
+        bool occluded(const ray3& ray, const float max_distance) const noexcept;
+
+        bool occluded_by_primitives(const ray3& ray, const float max_distance) const noexcept;
+
+        // Intersects a packet of up to 'ray_packet::MAX_SIZE' coherent rays. Falls back to single-ray queries if no acceleration structure is available.
+        void intersect(const ray3* const rays, const int count, hit_test* const __restrict results, primitive** const __restrict hit_primitives) const noexcept;
+
         inline mesh_reference add_triangularized_sphere(const vec3& center, const float& radius, const unsigned int subdivison_level = 2) noexcept
         {
             mesh_reference sphere = add_icosahedron(center, radius);
@@ -120,13 +270,16 @@ namespace ray_tracer_3d
 
             for (const int index : sphere._indices)
             {
-                const triangle* tri = reinterpret_cast<triangle*>(&mesh[index]);
+                const triangle* tri = static_cast<triangle*>(mesh[index]);
 
                 mesh[index] = new triangle(
                     tri->A.sub(center).normalize().scale(radius).add(center),
                     tri->B.sub(center).normalize().scale(radius).add(center),
                     tri->C.sub(center).normalize().scale(radius).add(center)
                 );
+                mesh[index]->material_index = tri->material_index;
+
+                delete tri;
             }
 
             return sphere;
@@ -139,16 +292,16 @@ namespace ray_tracer_3d
 
         inline mesh_reference add_triangle(const vec3& a, const vec3& b, const vec3& c, EULER_OPTARG) noexcept
         {
-            const std::vector<float> mat = vec3::create_rotation_matrix(euler_angles);
+            const affine_transform rotation = affine_transform::rotation(euler_angles);
 
-            return add_shape(new triangle(a.transform(mat), b.transform(mat), c.transform(mat)));
+            return add_shape(new triangle(rotation.transform_direction(a), rotation.transform_direction(b), rotation.transform_direction(c)));
         }
 
         inline mesh_reference add_planeXY(const vec3& pos, const float& sizeX, const float& sizeY, EULER_OPTARG) noexcept
         {
-            const auto mat = vec3::create_rotation_matrix(euler_angles);
-            const vec3 x = vec3(sizeX / 2, 0, 0).transform(mat);
-            const vec3 y = vec3(0, sizeY / 2, 0).transform(mat);
+            const affine_transform rotation = affine_transform::rotation(euler_angles);
+            const vec3 x = rotation.transform_direction(vec3(sizeX / 2, 0, 0));
+            const vec3 y = rotation.transform_direction(vec3(0, sizeY / 2, 0));
             const vec3 v00 = pos.sub(x).sub(y);
             const vec3 v01 = pos.sub(x).add(y);
             const vec3 v11 = pos.add(x).add(y);
@@ -156,8 +309,8 @@ namespace ray_tracer_3d
 
             return mesh_reference(this, std::vector<mesh_reference>
             {
-                add_triangle(v00, v01, v10, euler_angles),
-                add_triangle(v01, v11, v10, euler_angles),
+                add_triangle(v00, v01, v10),
+                add_triangle(v01, v11, v10),
             });
         }
 
@@ -193,10 +346,10 @@ namespace ray_tracer_3d
 
         inline mesh_reference add_cube(const vec3& center, const float& size_x, const float& size_y, const float& size_z, EULER_OPTARG) noexcept
         {
-            const auto mat = vec3::create_rotation_matrix(euler_angles);
-            const vec3 x = vec3(size_x / 2, 0, 0).transform(mat);
-            const vec3 y = vec3(0, size_y / 2, 0).transform(mat);
-            const vec3 z = vec3(0, 0, size_z / 2).transform(mat);
+            const affine_transform rotation = affine_transform::rotation(euler_angles);
+            const vec3 x = rotation.transform_direction(vec3(size_x / 2, 0, 0));
+            const vec3 y = rotation.transform_direction(vec3(0, size_y / 2, 0));
+            const vec3 z = rotation.transform_direction(vec3(0, 0, size_z / 2));
             const vec3 v111 = center.add(x).add(y).add(z);
             const vec3 v110 = center.add(x).add(y).sub(z);
             const vec3 v010 = center.sub(x).add(y).sub(z);
@@ -221,19 +374,18 @@ namespace ray_tracer_3d
         {
             constexpr float x = .525731112119133606;
             constexpr float z = .850650808352039932;
-            const auto mat = vec3::create_rotation_matrix(euler_angles);
-            const vec3 v0 = center.add(vec3(-x, 0, z).scale(size).transform(mat));
-            const vec3 v1 = center.add(vec3(x, 0, z).scale(size).transform(mat));
-            const vec3 v2 = center.add(vec3(-x, 0, -z).scale(size).transform(mat));
-            const vec3 v3 = center.add(vec3(x, 0, -z).scale(size).transform(mat));
-            const vec3 v4 = center.add(vec3(0, z, x).scale(size).transform(mat));
-            const vec3 v5 = center.add(vec3(0, z, -x).scale(size).transform(mat));
-            const vec3 v6 = center.add(vec3(0, -z, x).scale(size).transform(mat));
-            const vec3 v7 = center.add(vec3(0, -z, -x).scale(size).transform(mat));
-            const vec3 v8 = center.add(vec3(z, x, 0).scale(size).transform(mat));
-            const vec3 v9 = center.add(vec3(-z, x, 0).scale(size).transform(mat));
-            const vec3 v10 = center.add(vec3(z, -x, 0).scale(size).transform(mat));
-            const vec3 v11 = center.add(vec3(-z, -x, 0).scale(size).transform(mat));
+            const affine_transform transform = affine_transform::translation(center) * affine_transform::rotation(euler_angles) * affine_transform::scaling(size, size, size);
+            float vertices[12 * 3] = {
+                -x, 0, z,   x, 0, z,   -x, 0, -z,   x, 0, -z,
+                0, z, x,    0, z, -x,  0, -z, x,    0, -z, -x,
+                z, x, 0,    -z, x, 0,  z, -x, 0,    -z, -x, 0,
+            };
+
+            transform.transform_points(vertices, vertices, 12);
+
+            const auto vertex = [&](const int index) { return vec3(vertices[3 * index], vertices[3 * index + 1], vertices[3 * index + 2]); };
+            const vec3 v0 = vertex(0), v1 = vertex(1), v2 = vertex(2), v3 = vertex(3), v4 = vertex(4), v5 = vertex(5);
+            const vec3 v6 = vertex(6), v7 = vertex(7), v8 = vertex(8), v9 = vertex(9), v10 = vertex(10), v11 = vertex(11);
             std::vector<mesh_reference> references
             {
                 add_triangle(v0, v4, v1),
@@ -268,9 +420,74 @@ namespace ray_tracer_3d
             return mesh_reference(this, mesh.size() - 1);
         }
 
+        // Creates a mesh asset from the given object-space mesh, whose material table is appended to the scene's. Returns the asset's index.
+        inline uint add_mesh_asset(const indexed_mesh& indexed) noexcept
+        {
+            const uint first_material = materials.size();
+
+            materials.insert(materials.end(), indexed.materials, indexed.materials + indexed.material_count);
+
+            return add_mesh_asset(indexed, first_material);
+        }
+
+        // Creates a mesh asset from the given mesh, whose material table is already present in the scene's, starting at the given index.
+        inline uint add_mesh_asset(const indexed_mesh& indexed, const uint first_material) noexcept
+        {
+            indexed_mesh asset_mesh = indexed;
+
+            asset_mesh.first_material = first_material;
+            mesh_assets.push_back(std::make_shared<const mesh_asset>(asset_mesh));
+
+            return mesh_assets.size() - 1;
+        }
+
+        // Places the mesh asset with the given index through the given transform. Returns null if the asset or the override material does not exist, or if
+        // the transform is not invertible.
+        inline const mesh_instance* add_instance(const uint asset, const affine_transform& object_to_world, const uint material_override = mesh_instance::NO_MATERIAL_OVERRIDE) noexcept
+        {
+            affine_transform inverse;
+
+            if (asset >= mesh_assets.size() || !object_to_world.invert(&inverse))
+                return nullptr;
+            else if (material_override != mesh_instance::NO_MATERIAL_OVERRIDE && material_override >= materials.size())
+                return nullptr;
+
+            instances.emplace_back(mesh_assets[asset].get(), object_to_world, material_override);
+
+            return &instances.back();
+        }
+
+        // Appends the material to 'materials' and returns its index.
+        inline uint add_material(const material& mat) noexcept
+        {
+            materials.push_back(mat);
+
+            return materials.size() - 1;
+        }
+
+        // Adds the mesh and appends its material table to the scene's.
+        inline const indexed_mesh& add_indexed_mesh(const indexed_mesh& indexed) noexcept
+        {
+            const uint first_material = materials.size();
+
+            materials.insert(materials.end(), indexed.materials, indexed.materials + indexed.material_count);
+
+            return add_indexed_mesh(indexed, first_material);
+        }
+
+        // Adds the mesh, whose material table is already present in the scene's, starting at the given index.
+        inline const indexed_mesh& add_indexed_mesh(const indexed_mesh& indexed, const uint first_material) noexcept
+        {
+            indexed_meshes.push_back(indexed);
+            indexed_meshes.back().first_material = first_material;
+            indexed_mesh_offsets.push_back(indexed_mesh_offsets.back() + indexed.triangle_count);
+
+            return indexed_meshes.back();
+        }
+
         inline mesh_reference subdivide(const int triangle_idx) noexcept
         {
-            if (triangle_idx > 0 && triangle_idx < this->mesh.size())
+            if (triangle_idx < 0 || triangle_idx >= this->mesh.size() || mesh[triangle_idx]->type != primitive::primitive_type::triangle)
                 return mesh_reference::empty(this);
 
             //     A
@@ -279,19 +496,27 @@ namespace ray_tracer_3d
             //  / \ / \
             // B---BC--C
 
-            const triangle* tri = reinterpret_cast<triangle*>(&mesh[triangle_idx]);
+            // the original triangle is replaced by the first of its four sub-triangles, so that no overlapping geometry remains in the mesh
+            const triangle* tri = static_cast<triangle*>(mesh[triangle_idx]);
             const vec3 mAB = tri->A.add(tri->B).scale(.5);
             const vec3 mAC = tri->A.add(tri->C).scale(.5);
             const vec3 mBC = tri->B.add(tri->C).scale(.5);
-            const std::vector<mesh_reference> references
+
+            mesh[triangle_idx] = new triangle(tri->A, mAB, mAC);
+
+            mesh_reference references(this, std::vector<mesh_reference>
             {
-                add_triangle(tri->A, mAB,    mAC),
+                mesh_reference(this, triangle_idx),
                 add_triangle(mAB,    tri->B, mBC),
                 add_triangle(mAB,    mBC,    mAC),
                 add_triangle(mAC,    mBC,    tri->C),
-            };
+            });
 
-            return mesh_reference(this, references);
+            references.set_material(tri->material_index);
+
+            delete tri;
+
+            return references;
         }
 
         inline mesh_reference subdivide(mesh_reference& object)
@@ -0,0 +1,750 @@
+#include "scene_file.hpp"
+#include "mesh_importer.hpp"
+#include "../mapped_file.hpp"
+#include "../task_pool.hpp"
+
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <tuple>
+#include <unordered_map>
+
+using namespace ray_tracer_3d;
+
+
+static_assert(std::is_trivially_copyable_v<material> && sizeof(material) == 21 * sizeof(float), "binary scene files store materials as they are laid out in memory");
+static_assert(sizeof(scene_file_header) == 120 && sizeof(scene_file_light) == 76 && sizeof(scene_file_sphere) == 20);
+
+// size of the header of version 1 files, which ends before the normal and UV offsets
+static constexpr uint32_t VERSION_1_HEADER_SIZE = 104;
+
+// Reads the whitespace-separated tokens of one statement of a text scene file.
+class statement_parser
+{
+    const char* _position;
+    const char* const _end;
+
+public:
+    statement_parser(const char* const begin, const char* const end) noexcept
+        : _position(begin)
+        , _end(end)
+    {
+    }
+
+    // Returns the next token, or an empty one at the end of the statement.
+    std::string_view token() noexcept
+    {
+        while (_position < _end && std::isspace(static_cast<unsigned char>(*_position)))
+            ++_position;
+
+        const char* const begin = _position;
+
+        while (_position < _end && !std::isspace(static_cast<unsigned char>(*_position)))
+            ++_position;
+
+        return std::string_view(begin, _position - begin);
+    }
+
+    // Reads the next token as a number. The token is only consumed if it is one.
+    template<typename T>
+    bool number(T* const value) noexcept
+    {
+        const char* const position = _position;
+        const std::string_view text = token();
+        const auto [end, status] = std::from_chars(text.data(), text.data() + text.size(), *value);
+
+        if (!text.empty() && status == std::errc() && end == text.data() + text.size())
+            return true;
+
+        _position = position;
+
+        return false;
+    }
+
+    bool vector(vec3* const value) noexcept
+    {
+        float x, y, z;
+
+        if (!number(&x) || !number(&y) || !number(&z))
+            return false;
+
+        *value = vec3(x, y, z);
+
+        return true;
+    }
+
+    // Reads a color given as 'r g b [a]'.
+    bool color(ARGB* const value) noexcept
+    {
+        float alpha = 1;
+
+        if (!number(&value->R) || !number(&value->G) || !number(&value->B))
+            return false;
+
+        number(&alpha);
+        value->A = alpha;
+
+        return true;
+    }
+
+    bool at_end() noexcept
+    {
+        return token().empty();
+    }
+};
+
+// Creates the scene from the loaded lights, spheres and triangles. The mesh's material table becomes the scene's, which the spheres refer to. It is
+// followed by the imported meshes, which are paired with the index of their material within that table. Only the spheres are allocated one by one, as
+// the triangles remain in the meshes' arrays.
+static scene* create_scene(const std::vector<light>& lights, const scene_file_sphere* const spheres, const size_t sphere_count, const indexed_mesh& mesh, const std::vector<std::pair<indexed_mesh, uint>>& imported_meshes = { })
+{
+    scene* const result = new scene();
+
+    result->lights = lights;
+    result->mesh.reserve(sphere_count);
+
+    // the file's table replaces the default table, as no primitive refers to the latter yet
+    if (mesh.material_count)
+        result->materials.assign(mesh.materials, mesh.materials + mesh.material_count);
+
+    for (size_t i = 0; i < sphere_count; ++i)
+    {
+        const scene_file_sphere& sphere = spheres[i];
+
+        result->add_sphere(vec3(sphere.center[0], sphere.center[1], sphere.center[2]), sphere.radius).set_material(sphere.material);
+    }
+
+    if (mesh.triangle_count)
+        result->add_indexed_mesh(mesh, 0);
+
+    for (const auto& [imported, material_index] : imported_meshes)
+        if (imported.triangle_count)
+            result->add_indexed_mesh(imported, material_index);
+
+    return result;
+}
+
+static scene* load_text_scene(const mapped_file& file, const char* const path, std::string* const error)
+{
+    const std::shared_ptr<mesh_arrays> arrays = std::make_shared<mesh_arrays>();
+    std::unordered_map<std::string, uint> material_names;
+    std::vector<light> lights;
+    std::vector<scene_file_sphere> spheres;
+    std::vector<std::pair<indexed_mesh, uint>> imported_meshes;
+    // mesh assets paired with their material, and instances given by the index of their asset, their transform and their material override
+    std::vector<std::pair<indexed_mesh, uint>> assets;
+    std::unordered_map<std::string, uint> asset_names;
+    std::vector<std::tuple<uint, affine_transform, uint>> instances;
+    // the white default material is only added once it is used
+    uint current_material = ~0u;
+    size_t line_number = 0;
+
+    const auto fail = [&](const std::string& message) -> scene*
+    {
+        if (error)
+            *error = "line " + std::to_string(line_number) + ": " + message;
+
+        return nullptr;
+    };
+    const auto use_material = [&]() -> uint
+    {
+        if (current_material == ~0u)
+        {
+            current_material = arrays->materials.size();
+            arrays->materials.push_back(material::diffuse(ARGB::WHITE));
+        }
+
+        return current_material;
+    };
+
+    // imports a mesh file, whose path is relative to the scene file, with the current material
+    const auto import_relative = [&](const std::string_view file_name, indexed_mesh* const imported, std::string* const import_error)
+    {
+        const std::filesystem::path mesh_path = std::filesystem::path(reinterpret_cast<const char8_t*>(path)).parent_path()
+                                              / std::filesystem::path(std::u8string(reinterpret_cast<const char8_t*>(file_name.data()), file_name.size()));
+        const std::u8string mesh_path_text = mesh_path.u8string();
+
+        return import_mesh(reinterpret_cast<const char*>(mesh_path_text.c_str()), arrays->materials[use_material()], imported, import_error);
+    };
+
+    const char* const end = file.data() + file.size();
+    const char* line = file.data();
+
+    // editors may prepend a UTF-8 byte order mark
+    if (file.size() >= 3 && !std::memcmp(line, "\xEF\xBB\xBF", 3))
+        line += 3;
+
+    while (line < end)
+    {
+        const char* const line_end = std::find(line, end, '\n');
+        statement_parser parser(line, std::find(line, line_end, '#'));
+        const std::string_view keyword = parser.token();
+
+        line = line_end + (line_end < end);
+        ++line_number;
+
+        if (keyword.empty())
+            continue;
+        else if (keyword == "material")
+        {
+            const std::string name(parser.token());
+            material mat = material::diffuse(ARGB::WHITE);
+
+            if (name.empty())
+                return fail("missing material name");
+            else if (material_names.count(name))
+                return fail("material '" + name + "' is already defined");
+
+            for (std::string_view property = parser.token(); !property.empty(); property = parser.token())
+            {
+                bool valid;
+
+                if (property == "diffuse")
+                    valid = parser.color(&mat.DiffuseColor);
+                else if (property == "specular")
+                    valid = parser.color(&mat.SpecularColor);
+                else if (property == "emissive")
+                    valid = parser.color(&mat.EmissiveColor);
+                else if (property == "emissive_intensity")
+                    valid = parser.number(&mat.EmissiveIntensity);
+                else if (property == "specularity")
+                    valid = parser.number(&mat.Specularity);
+                else if (property == "specular_index")
+                    valid = parser.number(&mat.SpecularIndex);
+                else if (property == "reflectiveness")
+                    valid = parser.number(&mat.Reflectiveness);
+                else if (property == "refractiveness")
+                    valid = parser.number(&mat.Refractiveness);
+                else if (property == "refractive_index")
+                {
+                    float r, g, b;
+
+                    valid = parser.number(&r);
+
+                    if (valid && parser.number(&g))
+                        valid = parser.number(&b);
+                    else
+                        g = b = r;
+
+                    mat.RefractiveIndex = ARGB(r, g, b);
+                }
+                else
+                    return fail("unknown material property '" + std::string(property) + "'");
+
+                if (!valid)
+                    return fail("invalid value of the material property '" + std::string(property) + "'");
+            }
+
+            material_names[name] = arrays->materials.size();
+            arrays->materials.push_back(mat);
+        }
+        else if (keyword == "use")
+        {
+            const auto match = material_names.find(std::string(parser.token()));
+
+            if (match == material_names.end())
+                return fail("unknown material");
+
+            current_material = match->second;
+        }
+        else if (keyword == "spot_light" || keyword == "parallel_light" || keyword == "global_light")
+        {
+            const light defaults = light();
+            vec3 position = defaults.position;
+            vec3 direction = defaults.direction;
+            ARGB color = defaults.diffuse_color;
+            float intensity = defaults.diffuse_intensity;
+            float opening_angle = RAD2DEG(defaults.opening_angle);
+            float falloff = defaults.falloff_exponent;
+
+            for (std::string_view property = parser.token(); !property.empty(); property = parser.token())
+            {
+                bool valid;
+
+                if (property == "position")
+                    valid = parser.vector(&position);
+                else if (property == "direction")
+                    valid = parser.vector(&direction);
+                else if (property == "color")
+                    valid = parser.color(&color);
+                else if (property == "intensity")
+                    valid = parser.number(&intensity);
+                else if (property == "opening_angle")
+                    valid = parser.number(&opening_angle);
+                else if (property == "falloff")
+                    valid = parser.number(&falloff);
+                else
+                    return fail("unknown light property '" + std::string(property) + "'");
+
+                if (!valid)
+                    return fail("invalid value of the light property '" + std::string(property) + "'");
+            }
+
+            const light::light_mode mode = keyword == "spot_light" ? light::light_mode::Spot
+                                         : keyword == "parallel_light" ? light::light_mode::Parallel
+                                                                       : light::light_mode::Global;
+
+            lights.push_back(light(color, color, position, direction, intensity, intensity, DEG2RAD(opening_angle), falloff, mode));
+        }
+        else if (keyword == "sphere")
+        {
+            scene_file_sphere sphere;
+
+            if (!parser.number(sphere.center) || !parser.number(sphere.center + 1) || !parser.number(sphere.center + 2) || !parser.number(&sphere.radius) || !parser.at_end())
+                return fail("expected 'sphere x y z radius'");
+
+            sphere.material = use_material();
+            spheres.push_back(sphere);
+        }
+        else if (keyword == "vertex")
+        {
+            const size_t vertex_count = arrays->positions.size() / 3;
+            vec3 vertex, normal;
+            float uv[2] = { 0, 0 };
+            bool has_normal = false;
+            bool has_uv = false;
+
+            if (!parser.vector(&vertex))
+                return fail("expected 'vertex x y z [normal x y z] [uv u v]'");
+
+            for (std::string_view property = parser.token(); !property.empty(); property = parser.token())
+                if (property == "normal" && parser.vector(&normal))
+                    has_normal = true;
+                else if (property == "uv" && parser.number(uv) && parser.number(uv + 1))
+                    has_uv = true;
+                else
+                    return fail("expected 'vertex x y z [normal x y z] [uv u v]'");
+
+            // normals and UVs are only stored once any vertex has them, with zeros for the vertices without them
+            if (has_normal && arrays->normals.empty())
+                arrays->normals.resize(3 * vertex_count);
+
+            if (has_uv && arrays->uvs.empty())
+                arrays->uvs.resize(2 * vertex_count);
+
+            arrays->positions.insert(arrays->positions.end(), { vertex.X, vertex.Y, vertex.Z });
+
+            if (!arrays->normals.empty())
+                arrays->normals.insert(arrays->normals.end(), { normal.X, normal.Y, normal.Z });
+
+            if (!arrays->uvs.empty())
+                arrays->uvs.insert(arrays->uvs.end(), { uv[0], uv[1] });
+        }
+        else if (keyword == "triangle")
+        {
+            const long long vertex_count = arrays->positions.size() / 3;
+            long long indices[3];
+
+            if (!parser.number(indices) || !parser.number(indices + 1) || !parser.number(indices + 2) || !parser.at_end())
+                return fail("expected 'triangle a b c'");
+
+            for (long long index : indices)
+            {
+                if (index < 0)
+                    index += vertex_count;
+
+                if (index < 0 || index >= vertex_count)
+                    return fail("vertex index out of range");
+
+                arrays->indices.push_back(uint(index));
+            }
+
+            arrays->material_indices.push_back(use_material());
+        }
+        else if (keyword == "mesh")
+        {
+            const std::string_view file_name = parser.token();
+            std::string import_error;
+            indexed_mesh imported;
+
+            if (file_name.empty() || !parser.at_end())
+                return fail("expected 'mesh <path>'");
+            // the imported mesh refers to the current material of the scene's table rather than its own copy, so that both are edited together
+            else if (!import_relative(file_name, &imported, &import_error))
+                return fail(import_error);
+
+            imported_meshes.emplace_back(imported, use_material());
+        }
+        else if (keyword == "asset")
+        {
+            const std::string name(parser.token());
+            const std::string_view file_name = parser.token();
+            std::string import_error;
+            indexed_mesh imported;
+
+            if (name.empty() || file_name.empty() || !parser.at_end())
+                return fail("expected 'asset <name> <path>'");
+            else if (asset_names.count(name))
+                return fail("asset '" + name + "' is already defined");
+            else if (!import_relative(file_name, &imported, &import_error))
+                return fail(import_error);
+
+            asset_names[name] = assets.size();
+            assets.emplace_back(imported, use_material());
+        }
+        else if (keyword == "instance")
+        {
+            const auto asset = asset_names.find(std::string(parser.token()));
+            vec3 position, rotation, scale(1, 1, 1);
+            uint material_override = mesh_instance::NO_MATERIAL_OVERRIDE;
+
+            if (asset == asset_names.end())
+                return fail("unknown asset");
+
+            for (std::string_view property = parser.token(); !property.empty(); property = parser.token())
+            {
+                bool valid;
+
+                if (property == "position")
+                    valid = parser.vector(&position);
+                else if (property == "rotation")
+                    valid = parser.vector(&rotation);
+                else if (property == "scale")
+                {
+                    float x, y, z;
+
+                    valid = parser.number(&x);
+
+                    if (valid && parser.number(&y))
+                        valid = parser.number(&z);
+                    else
+                        y = z = x;
+
+                    scale = vec3(x, y, z);
+                }
+                else if (property == "material")
+                {
+                    const auto match = material_names.find(std::string(parser.token()));
+
+                    valid = match != material_names.end();
+                    material_override = valid ? match->second : material_override;
+                }
+                else
+                    return fail("unknown instance property '" + std::string(property) + "'");
+
+                if (!valid)
+                    return fail("invalid value of the instance property '" + std::string(property) + "'");
+            }
+
+            const affine_transform transform = affine_transform::create(position, scale, vec3(DEG2RAD(rotation.X), DEG2RAD(rotation.Y), DEG2RAD(rotation.Z)));
+            affine_transform inverse;
+
+            if (!transform.invert(&inverse))
+                return fail("the instance's transform is not invertible");
+
+            instances.emplace_back(asset->second, transform, material_override);
+        }
+        else
+            return fail("unknown statement '" + std::string(keyword) + "'");
+    }
+
+    // vertices following the last one with a normal or UV receive zeros as well
+    if (!arrays->normals.empty())
+        arrays->normals.resize(arrays->positions.size());
+
+    if (!arrays->uvs.empty())
+        arrays->uvs.resize(arrays->positions.size() / 3 * 2);
+
+    scene* const result = create_scene(lights, spheres.data(), spheres.size(), mesh_arrays::to_mesh(arrays), imported_meshes);
+
+    for (const auto& [asset, material_index] : assets)
+        result->add_mesh_asset(asset, material_index);
+
+    for (const auto& [asset, transform, material_override] : instances)
+        result->add_instance(asset, transform, material_override);
+
+    return result;
+}
+
+static scene* load_binary_scene(const std::shared_ptr<mapped_file>& file, std::string* const error)
+{
+    const auto fail = [&](const std::string& message) -> scene*
+    {
+        if (error)
+            *error = message;
+
+        return nullptr;
+    };
+    scene_file_header header = scene_file_header();
+
+    if (file->size() < VERSION_1_HEADER_SIZE)
+        return fail("truncated header");
+
+    // version 1 headers lack the normal and UV offsets, which remain zero
+    std::memcpy(&header, file->data(), VERSION_1_HEADER_SIZE);
+
+    if (header.version != 1 && header.version != scene_file_header::VERSION)
+        return fail("unsupported version " + std::to_string(header.version));
+    else if (header.version > 1 && header.header_size >= sizeof(scene_file_header) && file->size() >= sizeof(scene_file_header))
+        std::memcpy(&header, file->data(), sizeof(scene_file_header));
+
+    // sections must lie within the file and be aligned for in-place access
+    const auto is_valid_section = [&](const uint64_t offset, const uint64_t count, const size_t element_size)
+    {
+        return !count || (offset % alignof(float) == 0 && offset >= header.header_size && offset <= file->size() && count <= (file->size() - offset) / element_size);
+    };
+
+    if (header.header_size < (header.version > 1 ? sizeof(scene_file_header) : VERSION_1_HEADER_SIZE) ||
+        !is_valid_section(header.light_offset, header.light_count, sizeof(scene_file_light)) ||
+        !is_valid_section(header.material_offset, header.material_count, sizeof(material)) ||
+        !is_valid_section(header.sphere_offset, header.sphere_count, sizeof(scene_file_sphere)) ||
+        !is_valid_section(header.vertex_offset, header.vertex_count, 3 * sizeof(float)) ||
+        !is_valid_section(header.index_offset, header.triangle_count, 3 * sizeof(uint32_t)) ||
+        !is_valid_section(header.material_index_offset, header.triangle_count, sizeof(uint32_t)) ||
+        !is_valid_section(header.normal_offset, header.normal_offset ? header.vertex_count : 0, 3 * sizeof(float)) ||
+        !is_valid_section(header.uv_offset, header.uv_offset ? header.vertex_count : 0, 2 * sizeof(float)))
+        return fail("section out of bounds");
+    // primitives are indexed through 32 bit integers
+    else if (header.sphere_count + header.triangle_count >= std::numeric_limits<uint>::max())
+        return fail("too many primitives");
+
+    indexed_mesh mesh;
+
+    mesh.positions = reinterpret_cast<const float*>(file->data() + header.vertex_offset);
+    mesh.normals = header.normal_offset ? reinterpret_cast<const float*>(file->data() + header.normal_offset) : nullptr;
+    mesh.uvs = header.uv_offset ? reinterpret_cast<const float*>(file->data() + header.uv_offset) : nullptr;
+    mesh.indices = reinterpret_cast<const uint*>(file->data() + header.index_offset);
+    mesh.material_indices = reinterpret_cast<const uint*>(file->data() + header.material_index_offset);
+    mesh.materials = reinterpret_cast<const material*>(file->data() + header.material_offset);
+    mesh.vertex_count = header.vertex_count;
+    mesh.triangle_count = header.triangle_count;
+    mesh.material_count = header.material_count;
+    mesh.storage = file;
+
+    // the indices are validated once here, so that a corrupt file cannot make the renderer read outside of the mapping later on
+    std::atomic<bool> valid_indices = true;
+
+    parallel_for(size_t(0), mesh.triangle_count, [&](const size_t triangle)
+    {
+        if (mesh.indices[3 * triangle] >= mesh.vertex_count || mesh.indices[3 * triangle + 1] >= mesh.vertex_count ||
+            mesh.indices[3 * triangle + 2] >= mesh.vertex_count || mesh.material_indices[triangle] >= mesh.material_count)
+            valid_indices.store(false, std::memory_order_relaxed);
+    });
+
+    if (!valid_indices)
+        return fail("triangle index out of range");
+
+    std::vector<light> lights;
+    std::vector<scene_file_sphere> spheres(header.sphere_count);
+
+    if (!spheres.empty())
+        std::memcpy(spheres.data(), file->data() + header.sphere_offset, spheres.size() * sizeof(scene_file_sphere));
+
+    for (const scene_file_sphere& sphere : spheres)
+        if (sphere.material >= mesh.material_count)
+            return fail("sphere material out of range");
+
+    for (size_t i = 0; i < header.light_count; ++i)
+    {
+        scene_file_light record;
+
+        std::memcpy(&record, file->data() + header.light_offset + i * sizeof(scene_file_light), sizeof(scene_file_light));
+
+        if (record.mode > uint32_t(light::light_mode::Global))
+            return fail("invalid light mode");
+
+        lights.push_back(light(
+            ARGB(record.diffuse_color[0], record.diffuse_color[1], record.diffuse_color[2], record.diffuse_color[3]),
+            ARGB(record.specular_color[0], record.specular_color[1], record.specular_color[2], record.specular_color[3]),
+            vec3(record.position[0], record.position[1], record.position[2]),
+            vec3(record.direction[0], record.direction[1], record.direction[2]),
+            record.diffuse_intensity,
+            record.specular_intensity,
+            record.opening_angle,
+            record.falloff_exponent,
+            light::light_mode(record.mode)
+        ));
+    }
+
+    return create_scene(lights, spheres.data(), spheres.size(), mesh);
+}
+
+scene* ray_tracer_3d::load_scene(const char* const path, std::string* const error) noexcept
+{
+    // mesh files become scenes without lights, whose triangles are white
+    if (is_mesh_file(path))
+    {
+        indexed_mesh mesh;
+
+        if (!import_mesh(path, material::diffuse(ARGB::WHITE), &mesh, error))
+            return nullptr;
+
+        return create_scene({ }, nullptr, 0, mesh);
+    }
+
+    const std::shared_ptr<mapped_file> file = mapped_file::open(path);
+
+    if (!file)
+    {
+        if (error)
+            *error = "unable to open '" + std::string(path) + "'";
+
+        return nullptr;
+    }
+    else if (file->size() >= sizeof(scene_file_header::MAGIC) && !std::memcmp(file->data(), scene_file_header::MAGIC, sizeof(scene_file_header::MAGIC)))
+        return load_binary_scene(file, error);
+    else
+        return load_text_scene(*file, path, error);
+}
+
+bool ray_tracer_3d::save_scene(const scene& scene, const char* const path, std::string* const error) noexcept
+{
+    if (!scene.instances.empty())
+    {
+        if (error)
+            *error = "instances cannot be stored in binary form";
+
+        return false;
+    }
+
+    std::vector<scene_file_light> lights;
+    const std::vector<material>& materials = scene.materials;
+    std::vector<scene_file_sphere> spheres;
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<float> uvs;
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> material_indices;
+    // normals and UVs are only stored if any mesh has them, with zeros for the vertices of the others
+    const bool has_normals = std::any_of(scene.indexed_meshes.begin(), scene.indexed_meshes.end(), [](const indexed_mesh& mesh) { return mesh.normals; });
+    const bool has_uvs = std::any_of(scene.indexed_meshes.begin(), scene.indexed_meshes.end(), [](const indexed_mesh& mesh) { return mesh.uvs; });
+
+    for (const light& light : scene.lights)
+        lights.push_back({
+            uint32_t(light.mode),
+            { light.position.X, light.position.Y, light.position.Z },
+            { light.direction.X, light.direction.Y, light.direction.Z },
+            { light.diffuse_color.A, light.diffuse_color.R, light.diffuse_color.G, light.diffuse_color.B },
+            { light.specular_color.A, light.specular_color.R, light.specular_color.G, light.specular_color.B },
+            light.diffuse_intensity,
+            light.specular_intensity,
+            light.opening_angle,
+            light.falloff_exponent,
+        });
+
+    for (const primitive* const primitive : scene.mesh)
+    {
+        if (primitive->type == primitive::primitive_type::sphere)
+        {
+            const sphere* const s = static_cast<const sphere*>(primitive);
+
+            spheres.push_back({ { s->center.X, s->center.Y, s->center.Z }, s->radius, primitive->material_index });
+        }
+        else
+        {
+            const triangle* const tri = static_cast<const triangle*>(primitive);
+
+            for (const vec3* const vertex : { &tri->A, &tri->B, &tri->C })
+            {
+                indices.push_back(positions.size() / 3);
+                positions.insert(positions.end(), { vertex->X, vertex->Y, vertex->Z });
+            }
+
+            material_indices.push_back(primitive->material_index);
+        }
+    }
+
+    for (const indexed_mesh& mesh : scene.indexed_meshes)
+    {
+        const uint32_t first_vertex = positions.size() / 3;
+
+        positions.insert(positions.end(), mesh.positions, mesh.positions + 3 * mesh.vertex_count);
+
+        if (has_normals)
+        {
+            normals.resize(positions.size() - 3 * mesh.vertex_count);
+
+            if (mesh.normals)
+                normals.insert(normals.end(), mesh.normals, mesh.normals + 3 * mesh.vertex_count);
+        }
+
+        if (has_uvs)
+        {
+            uvs.resize((positions.size() / 3 - mesh.vertex_count) * 2);
+
+            if (mesh.uvs)
+                uvs.insert(uvs.end(), mesh.uvs, mesh.uvs + 2 * mesh.vertex_count);
+        }
+
+        for (size_t t = 0; t < mesh.triangle_count; ++t)
+        {
+            for (int corner = 0; corner < 3; ++corner)
+                indices.push_back(first_vertex + mesh.indices[3 * t + corner]);
+
+            material_indices.push_back(mesh.material_index_of(t));
+        }
+    }
+
+    scene_file_header header = scene_file_header();
+    uint64_t offset = sizeof(scene_file_header);
+
+    const auto place = [&](const uint64_t size) -> uint64_t
+    {
+        const uint64_t start = (offset + scene_file_header::SECTION_ALIGNMENT - 1) / scene_file_header::SECTION_ALIGNMENT * scene_file_header::SECTION_ALIGNMENT;
+
+        offset = start + size;
+
+        return start;
+    };
+
+    std::memcpy(header.magic, scene_file_header::MAGIC, sizeof(header.magic));
+    header.version = scene_file_header::VERSION;
+    header.header_size = sizeof(scene_file_header);
+    header.light_count = lights.size();
+    header.light_offset = place(lights.size() * sizeof(scene_file_light));
+    header.material_count = materials.size();
+    header.material_offset = place(materials.size() * sizeof(material));
+    header.sphere_count = spheres.size();
+    header.sphere_offset = place(spheres.size() * sizeof(scene_file_sphere));
+    header.vertex_count = positions.size() / 3;
+    header.vertex_offset = place(positions.size() * sizeof(float));
+    header.triangle_count = material_indices.size();
+    header.index_offset = place(indices.size() * sizeof(uint32_t));
+    header.material_index_offset = place(material_indices.size() * sizeof(uint32_t));
+
+    if (has_normals)
+    {
+        normals.resize(positions.size());
+        header.normal_offset = place(normals.size() * sizeof(float));
+    }
+
+    if (has_uvs)
+    {
+        uvs.resize(positions.size() / 3 * 2);
+        header.uv_offset = place(uvs.size() * sizeof(float));
+    }
+
+    std::ofstream file(std::filesystem::path(reinterpret_cast<const char8_t*>(path)), std::ios::binary);
+    uint64_t written = 0;
+
+    // sections are written in the order they have been placed in, padded with zeros up to their offsets
+    const auto write = [&](const uint64_t section_offset, const void* const data, const uint64_t size)
+    {
+        static const char PADDING[scene_file_header::SECTION_ALIGNMENT] = { };
+
+        file.write(PADDING, section_offset - written);
+        file.write(static_cast<const char*>(data), size);
+        written = section_offset + size;
+    };
+
+    write(0, &header, sizeof(scene_file_header));
+    write(header.light_offset, lights.data(), lights.size() * sizeof(scene_file_light));
+    write(header.material_offset, materials.data(), materials.size() * sizeof(material));
+    write(header.sphere_offset, spheres.data(), spheres.size() * sizeof(scene_file_sphere));
+    write(header.vertex_offset, positions.data(), positions.size() * sizeof(float));
+    write(header.index_offset, indices.data(), indices.size() * sizeof(uint32_t));
+    write(header.material_index_offset, material_indices.data(), material_indices.size() * sizeof(uint32_t));
+
+    if (has_normals)
+        write(header.normal_offset, normals.data(), normals.size() * sizeof(float));
+
+    if (has_uvs)
+        write(header.uv_offset, uvs.data(), uvs.size() * sizeof(float));
+
+    file.flush();
+
+    if (!file && error)
+        *error = "unable to write '" + std::string(path) + "'";
+
+    return bool(file);
+}
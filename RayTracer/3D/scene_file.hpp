@@ -0,0 +1,95 @@
+#pragma once
+
+#include "scene.hpp"
+
+
+// Scenes can be stored in two file forms, which 'load_scene' tells apart by the magic number of the binary form.
+//
+// The text form is meant for authoring. Every line holds one statement, and everything following a '#' is a comment:
+//
+//     material <name> [diffuse r g b [a]] [specular r g b [a]] [emissive r g b [a]] [emissive_intensity x] [specularity x]
+//                     [specular_index x] [reflectiveness x] [refractiveness x] [refractive_index x | r g b]
+//     use <name>
+//     spot_light [position x y z] [direction x y z] [color r g b [a]] [intensity x] [opening_angle degrees] [falloff x]
+//     parallel_light [direction x y z] [color r g b [a]] [intensity x]
+//     global_light [color r g b [a]] [intensity x]
+//     sphere x y z radius
+//     vertex x y z [normal x y z] [uv u v]
+//     triangle a b c
+//     mesh <path>
+//     asset <name> <path>
+//     instance <asset name> [position x y z] [rotation x y z (degrees)] [scale x | x y z] [material <name>]
+//
+// Omitted light properties take the values of the default 'light'. Materials start out as white diffuse materials, whose properties are then
+// overridden. Spheres and triangles receive the material selected by the last 'use' statement (the white default before the first one). Triangle
+// vertices are zero-based indices of the vertices declared so far, or count back from the last vertex if negative (-1 being the last one). Vertex
+// normals and UVs default to zero if only some vertices have them, and zero normals fall back to the face normal. 'mesh' imports an OBJ or binary PLY
+// file (see 'import_mesh'), whose path is relative to the scene file, with the current material.
+// 'asset' imports such a file as a mesh asset, which 'instance' places any number of times (see 'mesh_instance'), optionally with a material of its own.
+//
+// The binary form is meant for large assets. It consists of a 'scene_file_header' followed by the sections it points to, all in little-endian byte
+// order. The file is memory-mapped when loaded, and its vertex, index, material index and material sections are used in place as the arrays of an
+// indexed mesh, so that no per-triangle objects are ever created and loading is bounded by the disk rather than the allocator.
+namespace ray_tracer_3d
+{
+    struct scene_file_header
+    {
+        static constexpr char MAGIC[8] = { 'R', 'T', 'S', 'C', 'E', 'N', 'E', '\x1a' };
+        // version 2 added the normal and UV sections. version 1 files, whose header ends before them, are still read.
+        static constexpr uint32_t VERSION = 2;
+        // sections start at multiples of this, which keeps them aligned for in-place access
+        static constexpr uint64_t SECTION_ALIGNMENT = 64;
+
+        char magic[8];
+        uint32_t version;
+        uint32_t header_size;
+        // 'scene_file_light' records
+        uint64_t light_count;
+        uint64_t light_offset;
+        // 'material' structs as they are laid out in memory (21 floats each)
+        uint64_t material_count;
+        uint64_t material_offset;
+        // 'scene_file_sphere' records
+        uint64_t sphere_count;
+        uint64_t sphere_offset;
+        // three floats per vertex
+        uint64_t vertex_count;
+        uint64_t vertex_offset;
+        // three 32 bit vertex indices and one 32 bit material index per triangle, stored in two sections
+        uint64_t triangle_count;
+        uint64_t index_offset;
+        uint64_t material_index_offset;
+        // optional (i.e. zero if absent) sections of three normal components and two texture coordinates per vertex
+        uint64_t normal_offset;
+        uint64_t uv_offset;
+    };
+
+    struct scene_file_light
+    {
+        uint32_t mode;
+        float position[3];
+        float direction[3];
+        // colors are stored in the order of the 'ARGB' struct
+        float diffuse_color[4];
+        float specular_color[4];
+        float diffuse_intensity;
+        float specular_intensity;
+        float opening_angle;
+        float falloff_exponent;
+    };
+
+    struct scene_file_sphere
+    {
+        float center[3];
+        float radius;
+        uint32_t material;
+    };
+
+    // Loads the scene file with the given UTF-8 encoded path in either form, or imports a mesh file (.obj or .ply) as a scene without lights. Returns null if the file cannot be read or is malformed, in which case
+    // 'error' (if given) receives a description of the problem. The scene is released through 'DeleteScene3' as any other scene.
+    scene* load_scene(const char* const path, std::string* const error = nullptr) noexcept;
+
+    // Writes the scene to the given path in binary form. Triangles of the scene's mesh become indexed triangles with vertices of their own, and all
+    // indexed meshes are merged into one. The scene's material table is stored as it is. Scenes with instances cannot be stored yet. Returns false if the file cannot be written, in which case 'error' (if given) receives a description.
+    bool save_scene(const scene& scene, const char* const path, std::string* const error = nullptr) noexcept;
+};
@@ -0,0 +1,152 @@
+#include "tile_scheduler.hpp"
+
+using namespace ray_tracer_3d;
+
+
+#define PACK_RANGE(begin, end) ((static_cast<unsigned long long>(begin) << 32) | static_cast<unsigned long long>(end))
+#define RANGE_BEGIN(range) static_cast<uint>((range) >> 32)
+#define RANGE_END(range) static_cast<uint>((range) & 0xffffffffull)
+
+
+ray_tracer_3d::tile_scheduler::tile_scheduler(const int width, const int height, const int tile_size, const tile_order order) noexcept
+{
+    const int size = tile_size > 0 ? tile_size : DEFAULT_TILE_SIZE;
+    const uint tiles_x = (std::max(width, 0) + size - 1) / size;
+    const uint tiles_y = (std::max(height, 0) + size - 1) / size;
+    uint grid_size = 1;
+
+    while (grid_size < std::max(tiles_x, tiles_y))
+        grid_size <<= 1;
+
+    std::vector<std::pair<unsigned long long, tile>> keyed;
+
+    keyed.reserve(size_t(tiles_x) * tiles_y);
+
+    for (uint ty = 0; ty < tiles_y; ++ty)
+        for (uint tx = 0; tx < tiles_x; ++tx)
+        {
+            const tile t = {
+                int(tx) * size,
+                int(ty) * size,
+                std::min(size, width - int(tx) * size),
+                std::min(size, height - int(ty) * size),
+            };
+            unsigned long long key = keyed.size();
+
+            if (order == tile_order::morton_curve)
+                key = morton_index(tx, ty);
+            else if (order == tile_order::hilbert_curve)
+                key = hilbert_index(grid_size, tx, ty);
+
+            keyed.push_back(std::make_pair(key, t));
+        }
+
+    std::stable_sort(keyed.begin(), keyed.end(), [](const auto& a, const auto& b)
+    {
+        return a.first < b.first;
+    });
+
+    _tiles.reserve(keyed.size());
+
+    for (const auto& entry : keyed)
+        _tiles.push_back(entry.second);
+}
+
+void ray_tracer_3d::tile_scheduler::distribute(const int worker_count) noexcept
+{
+    const uint count = _tiles.size();
+
+    _worker_count = std::max(worker_count, 1);
+    _ranges.reset(new worker_range[_worker_count]);
+
+    // contiguous ranges keep neighbouring tiles on the same worker, as the tiles are already sorted along the curve
+    for (int worker = 0; worker < _worker_count; ++worker)
+    {
+        const uint begin = size_t(count) * worker / _worker_count;
+        const uint end = size_t(count) * (worker + 1) / _worker_count;
+
+        _ranges[worker].range.store(PACK_RANGE(begin, end), std::memory_order_relaxed);
+    }
+}
+
+bool ray_tracer_3d::tile_scheduler::pop(const int worker, uint* const index) noexcept
+{
+    std::atomic<unsigned long long>& range = _ranges[worker].range;
+    unsigned long long current = range.load(std::memory_order_acquire);
+
+    while (RANGE_BEGIN(current) < RANGE_END(current))
+        if (range.compare_exchange_weak(current, PACK_RANGE(RANGE_BEGIN(current) + 1, RANGE_END(current)), std::memory_order_acq_rel))
+        {
+            *index = RANGE_BEGIN(current);
+
+            return true;
+        }
+
+    return false;
+}
+
+bool ray_tracer_3d::tile_scheduler::steal(const int worker, uint* const index) noexcept
+{
+    // a tile index is never handed out twice, so a range can not reappear once it has been changed (no ABA problem)
+    for (int offset = 1; offset < _worker_count; ++offset)
+    {
+        std::atomic<unsigned long long>& victim = _ranges[(worker + offset) % _worker_count].range;
+        unsigned long long current = victim.load(std::memory_order_acquire);
+
+        while (RANGE_BEGIN(current) < RANGE_END(current))
+        {
+            const uint begin = RANGE_BEGIN(current);
+            const uint end = RANGE_END(current);
+            const uint middle = begin + (end - begin) / 2;
+
+            if (victim.compare_exchange_weak(current, PACK_RANGE(begin, middle), std::memory_order_acq_rel))
+            {
+                // the own range is empty at this point, so it can be replaced by the stolen one
+                _ranges[worker].range.store(PACK_RANGE(middle + 1, end), std::memory_order_release);
+                *index = middle;
+
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+unsigned long long ray_tracer_3d::tile_scheduler::morton_index(const uint x, const uint y) noexcept
+{
+    unsigned long long index = 0;
+
+    for (int bit = 0; bit < 32; ++bit)
+        index |= ((static_cast<unsigned long long>(x) >> bit & 1) << (2 * bit))
+               | ((static_cast<unsigned long long>(y) >> bit & 1) << (2 * bit + 1));
+
+    return index;
+}
+
+unsigned long long ray_tracer_3d::tile_scheduler::hilbert_index(const uint size, uint x, uint y) noexcept
+{
+    unsigned long long index = 0;
+
+    for (uint s = size / 2; s > 0; s /= 2)
+    {
+        const uint rx = (x & s) > 0;
+        const uint ry = (y & s) > 0;
+
+        index += static_cast<unsigned long long>(s) * s * ((3 * rx) ^ ry);
+
+        // rotate the quadrant, so that the curve stays continuous
+        if (!ry)
+        {
+            if (rx)
+            {
+                x = size - 1 - x;
+                y = size - 1 - y;
+            }
+
+            std::swap(x, y);
+        }
+    }
+
+    return index;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "../task_pool.hpp"
+
+
+namespace ray_tracer_3d
+{
+    enum tile_order
+    {
+        scanline,
+        morton_curve,
+        hilbert_curve,
+    };
+
+    struct tile
+    {
+        int x;
+        int y;
+        int width;
+        int height;
+
+
+        inline size_t pixel_count() const noexcept
+        {
+            return size_t(width) * height;
+        }
+
+        TO_STRING(tile, "X=" << x << ",Y=" << y << ",W=" << width << ",H=" << height);
+    };
+
+    // Splits an image into tiles, sorts them along a space-filling curve and hands them out to a fixed number of workers.
+    // Every worker initially owns a contiguous range of the sorted tile list, which it processes front-to-back. A worker whose range runs empty
+    // steals the back half of another worker's range, so that all workers stay busy until the last tile has been claimed.
+    class tile_scheduler
+    {
+    public:
+        static constexpr int DEFAULT_TILE_SIZE = 32;
+
+    private:
+        // the range [begin, end) of a worker is packed as (begin << 32) | end, so that popping and stealing are a single compare-and-swap each
+        struct alignas(64) worker_range
+        {
+            std::atomic<unsigned long long> range;
+        };
+
+        std::vector<tile> _tiles;
+        std::unique_ptr<worker_range[]> _ranges;
+        int _worker_count = 0;
+
+        void distribute(const int worker_count) noexcept;
+
+        bool pop(const int worker, uint* const index) noexcept;
+
+        bool steal(const int worker, uint* const index) noexcept;
+    public:
+        tile_scheduler(const int width, const int height, const int tile_size, const tile_order order) noexcept;
+
+        inline size_t tile_count() const noexcept
+        {
+            return _tiles.size();
+        }
+
+        inline const std::vector<tile>& tiles() const noexcept
+        {
+            return _tiles;
+        }
+
+        // Calls 'func(const tile&, int worker)' exactly once for every tile, using 'worker_count' parallel workers, which are numbered from zero. A worker index
+        // is never used by two threads at the same time. Returns after all tiles have been processed.
+        template<typename F>
+        void run(const int worker_count, const F& func) noexcept
+        {
+            distribute(worker_count);
+
+            parallel_for(0, _worker_count, [&](const int worker)
+            {
+                uint index;
+
+                while (pop(worker, &index) || steal(worker, &index))
+                    func(_tiles[index], worker);
+            }, 1);
+        }
+
+        // Returns the position of the tile (x, y) along the Morton curve (Z-order).
+        static unsigned long long morton_index(const uint x, const uint y) noexcept;
+
+        // Returns the position of the tile (x, y) along the Hilbert curve covering a square grid of 'size' x 'size' tiles. 'size' must be a power of two.
+        static unsigned long long hilbert_index(const uint size, uint x, uint y) noexcept;
+
+        TO_STRING(tile_scheduler, "Tiles=" << _tiles.size() << ",Workers=" << _worker_count);
+    };
+};
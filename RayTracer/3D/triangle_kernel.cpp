@@ -0,0 +1,273 @@
+#include "triangle_kernel.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define KERNEL_X86 1
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+// only AVX2 is enabled (and not FMA), so that the compiler cannot contract multiplications and additions, which would break the bit-exactness
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define KERNEL_X86 0
+#endif
+
+using namespace ray_tracer_3d;
+
+
+const kernel_isa ray_tracer_3d::active_kernel_isa = detect_kernel_isa();
+const triangle_kernel ray_tracer_3d::intersect_triangles = get_triangle_kernel(active_kernel_isa);
+
+
+bool ray_tracer_3d::intersect_triangles_scalar(
+    const triangle_store& store,
+    const size_t first,
+    const size_t last,
+    const float* const __restrict origin,
+    const float* const __restrict direction,
+    triangle_hit* const __restrict hit
+)
+{
+    bool found = false;
+
+    for (size_t slot = first; slot < last; ++slot)
+    {
+        float t, u, v;
+        bool backface;
+
+        if (store.intersect(slot, origin, direction, &t, &u, &v, &backface) && t < hit->distance)
+        {
+            *hit = { t, u, v, slot, backface };
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+bool ray_tracer_3d::intersect_triangles_sse(
+    const triangle_store& store,
+    const size_t first,
+    const size_t last,
+    const float* const __restrict origin,
+    const float* const __restrict direction,
+    triangle_hit* const __restrict hit
+)
+{
+#if KERNEL_X86
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 epsilon = _mm_set1_ps(triangle_store::INTERSECTION_EPSILON);
+    const __m128 negative_epsilon = _mm_set1_ps(-triangle_store::INTERSECTION_EPSILON);
+    const __m128 ox = _mm_set1_ps(origin[0]);
+    const __m128 oy = _mm_set1_ps(origin[1]);
+    const __m128 oz = _mm_set1_ps(origin[2]);
+    const __m128 dx = _mm_set1_ps(direction[0]);
+    const __m128 dy = _mm_set1_ps(direction[1]);
+    const __m128 dz = _mm_set1_ps(direction[2]);
+    const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+    bool found = false;
+
+    // the streams are padded with degenerate slots, so the last block may safely read past 'last'
+    for (size_t base = first; base < last; base += 4)
+    {
+        const __m128 e1x = _mm_loadu_ps(&store.e1x[base]);
+        const __m128 e1y = _mm_loadu_ps(&store.e1y[base]);
+        const __m128 e1z = _mm_loadu_ps(&store.e1z[base]);
+        const __m128 e2x = _mm_loadu_ps(&store.e2x[base]);
+        const __m128 e2y = _mm_loadu_ps(&store.e2y[base]);
+        const __m128 e2z = _mm_loadu_ps(&store.e2z[base]);
+        const __m128 hx = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        const __m128 hy = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        const __m128 hz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+        const __m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, hx), _mm_mul_ps(e1y, hy)), _mm_mul_ps(e1z, hz));
+        __m128 valid = _mm_or_ps(_mm_cmple_ps(a, negative_epsilon), _mm_cmpge_ps(a, epsilon));
+
+        if (!_mm_movemask_ps(valid))
+            continue;
+
+        const __m128 f = _mm_div_ps(one, a);
+        const __m128 sx = _mm_sub_ps(ox, _mm_loadu_ps(&store.v0x[base]));
+        const __m128 sy = _mm_sub_ps(oy, _mm_loadu_ps(&store.v0y[base]));
+        const __m128 sz = _mm_sub_ps(oz, _mm_loadu_ps(&store.v0z[base]));
+        const __m128 u = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, hx), _mm_mul_ps(sy, hy)), _mm_mul_ps(sz, hz)));
+
+        valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmple_ps(u, one)));
+
+        const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+        const __m128 v = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)));
+
+        valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(v, zero), _mm_cmple_ps(_mm_add_ps(u, v), one)));
+
+        const __m128 t = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)));
+
+        valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpgt_ps(t, epsilon), _mm_cmplt_ps(t, _mm_set1_ps(hit->distance))));
+        valid = _mm_and_ps(valid, _mm_castsi128_ps(_mm_cmplt_epi32(lanes, _mm_set1_epi32(int(std::min<size_t>(last - base, 4))))));
+
+        if (const int mask = _mm_movemask_ps(valid))
+        {
+            alignas(16) float ts[4], us[4], vs[4], as[4];
+
+            _mm_store_ps(ts, t);
+            _mm_store_ps(us, u);
+            _mm_store_ps(vs, v);
+            _mm_store_ps(as, a);
+
+            for (int lane = 0; lane < 4; ++lane)
+                if ((mask & (1 << lane)) && ts[lane] < hit->distance)
+                {
+                    *hit = { ts[lane], us[lane], vs[lane], base + lane, as[lane] < -triangle_store::INTERSECTION_EPSILON };
+                    found = true;
+                }
+        }
+    }
+
+    return found;
+#else
+    return intersect_triangles_scalar(store, first, last, origin, direction, hit);
+#endif
+}
+
+#if KERNEL_X86
+TARGET_AVX2
+#endif
+bool ray_tracer_3d::intersect_triangles_avx2(
+    const triangle_store& store,
+    const size_t first,
+    const size_t last,
+    const float* const __restrict origin,
+    const float* const __restrict direction,
+    triangle_hit* const __restrict hit
+)
+{
+#if KERNEL_X86
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.f);
+    const __m256 epsilon = _mm256_set1_ps(triangle_store::INTERSECTION_EPSILON);
+    const __m256 negative_epsilon = _mm256_set1_ps(-triangle_store::INTERSECTION_EPSILON);
+    const __m256 ox = _mm256_set1_ps(origin[0]);
+    const __m256 oy = _mm256_set1_ps(origin[1]);
+    const __m256 oz = _mm256_set1_ps(origin[2]);
+    const __m256 dx = _mm256_set1_ps(direction[0]);
+    const __m256 dy = _mm256_set1_ps(direction[1]);
+    const __m256 dz = _mm256_set1_ps(direction[2]);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    bool found = false;
+
+    // the streams are padded with degenerate slots, so the last block may safely read past 'last'
+    for (size_t base = first; base < last; base += 8)
+    {
+        const __m256 e1x = _mm256_loadu_ps(&store.e1x[base]);
+        const __m256 e1y = _mm256_loadu_ps(&store.e1y[base]);
+        const __m256 e1z = _mm256_loadu_ps(&store.e1z[base]);
+        const __m256 e2x = _mm256_loadu_ps(&store.e2x[base]);
+        const __m256 e2y = _mm256_loadu_ps(&store.e2y[base]);
+        const __m256 e2z = _mm256_loadu_ps(&store.e2z[base]);
+        const __m256 hx = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+        const __m256 hy = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+        const __m256 hz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+        const __m256 a = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, hx), _mm256_mul_ps(e1y, hy)), _mm256_mul_ps(e1z, hz));
+        __m256 valid = _mm256_or_ps(_mm256_cmp_ps(a, negative_epsilon, _CMP_LE_OQ), _mm256_cmp_ps(a, epsilon, _CMP_GE_OQ));
+
+        if (!_mm256_movemask_ps(valid))
+            continue;
+
+        const __m256 f = _mm256_div_ps(one, a);
+        const __m256 sx = _mm256_sub_ps(ox, _mm256_loadu_ps(&store.v0x[base]));
+        const __m256 sy = _mm256_sub_ps(oy, _mm256_loadu_ps(&store.v0y[base]));
+        const __m256 sz = _mm256_sub_ps(oz, _mm256_loadu_ps(&store.v0z[base]));
+        const __m256 u = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, hx), _mm256_mul_ps(sy, hy)), _mm256_mul_ps(sz, hz)));
+
+        valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GE_OQ), _mm256_cmp_ps(u, one, _CMP_LE_OQ)));
+
+        const __m256 qx = _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(sz, e1y));
+        const __m256 qy = _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(sx, e1z));
+        const __m256 qz = _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(sy, e1x));
+        const __m256 v = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)));
+
+        valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(v, zero, _CMP_GE_OQ), _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ)));
+
+        const __m256 t = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)));
+
+        valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(t, epsilon, _CMP_GT_OQ), _mm256_cmp_ps(t, _mm256_set1_ps(hit->distance), _CMP_LT_OQ)));
+        valid = _mm256_and_ps(valid, _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(int(std::min<size_t>(last - base, 8))), lanes)));
+
+        if (const int mask = _mm256_movemask_ps(valid))
+        {
+            alignas(32) float ts[8], us[8], vs[8], as[8];
+
+            _mm256_store_ps(ts, t);
+            _mm256_store_ps(us, u);
+            _mm256_store_ps(vs, v);
+            _mm256_store_ps(as, a);
+
+            for (int lane = 0; lane < 8; ++lane)
+                if ((mask & (1 << lane)) && ts[lane] < hit->distance)
+                {
+                    *hit = { ts[lane], us[lane], vs[lane], base + lane, as[lane] < -triangle_store::INTERSECTION_EPSILON };
+                    found = true;
+                }
+        }
+    }
+
+    return found;
+#else
+    return intersect_triangles_scalar(store, first, last, origin, direction, hit);
+#endif
+}
+
+kernel_isa ray_tracer_3d::detect_kernel_isa() noexcept
+{
+#if KERNEL_X86
+#ifdef _MSC_VER
+    int info[4];
+
+    __cpuid(info, 0);
+
+    const int max_leaf = info[0];
+
+    __cpuid(info, 1);
+
+    const bool sse2 = info[3] & (1 << 26);
+    const bool osxsave = info[2] & (1 << 27);
+    const bool avx = info[2] & (1 << 28);
+    bool avx2 = false;
+
+    // the OS must also save the YMM registers on context switches
+    if (max_leaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6)
+    {
+        __cpuidex(info, 7, 0);
+
+        avx2 = info[1] & (1 << 5);
+    }
+#else
+    __builtin_cpu_init();
+
+    const bool sse2 = __builtin_cpu_supports("sse2");
+    const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+    return avx2 ? kernel_isa::avx2 : sse2 ? kernel_isa::sse : kernel_isa::scalar;
+#else
+    return kernel_isa::scalar;
+#endif
+}
+
+triangle_kernel ray_tracer_3d::get_triangle_kernel(const kernel_isa isa) noexcept
+{
+    switch (isa)
+    {
+        case kernel_isa::avx2:
+            return intersect_triangles_avx2;
+        case kernel_isa::sse:
+            return intersect_triangles_sse;
+        case kernel_isa::scalar:
+        default:
+            return intersect_triangles_scalar;
+    }
+}
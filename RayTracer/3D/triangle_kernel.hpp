@@ -0,0 +1,52 @@
+#pragma once
+
+#include "triangle_store.hpp"
+
+
+namespace ray_tracer_3d
+{
+    struct triangle_hit
+    {
+        float distance;
+        float u;
+        float v;
+        size_t slot;
+        bool backface;
+    };
+
+    // Tests one ray against the triangle store slots [first, last) and updates 'hit' if a slot is hit closer than 'hit->distance'.
+    // Ties are resolved towards the lowest slot index, so that all kernels produce bit-identical results.
+    typedef bool (*triangle_kernel)(
+        const triangle_store& store,
+        const size_t first,
+        const size_t last,
+        const float* const __restrict origin,
+        const float* const __restrict direction,
+        triangle_hit* const __restrict hit
+    );
+
+    enum class kernel_isa
+    {
+        scalar,
+        sse,
+        avx2,
+    };
+
+    // Scalar reference kernel. It is built on 'triangle_store::intersect' and mirrors the exact operation order of the SIMD kernels.
+    bool intersect_triangles_scalar(const triangle_store&, const size_t, const size_t, const float* const __restrict, const float* const __restrict, triangle_hit* const __restrict);
+
+    // 4-wide SSE2 kernel (x86 only).
+    bool intersect_triangles_sse(const triangle_store&, const size_t, const size_t, const float* const __restrict, const float* const __restrict, triangle_hit* const __restrict);
+
+    // 8-wide AVX2 kernel (x86 only).
+    bool intersect_triangles_avx2(const triangle_store&, const size_t, const size_t, const float* const __restrict, const float* const __restrict, triangle_hit* const __restrict);
+
+    // Returns the widest instruction set supported by both the build and the executing CPU.
+    kernel_isa detect_kernel_isa() noexcept;
+
+    triangle_kernel get_triangle_kernel(const kernel_isa isa) noexcept;
+
+    // The kernel selected at startup through 'detect_kernel_isa()'.
+    extern const kernel_isa active_kernel_isa;
+    extern const triangle_kernel intersect_triangles;
+};
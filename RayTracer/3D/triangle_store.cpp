@@ -0,0 +1,155 @@
+#include "triangle_kernel.hpp"
+#include "../task_pool.hpp"
+
+using namespace ray_tracer_3d;
+
+
+void ray_tracer_3d::triangle_store::clear() noexcept
+{
+    for (std::vector<float>* stream : { &v0x, &v0y, &v0z, &e1x, &e1y, &e1z, &e2x, &e2y, &e2z })
+        stream->clear();
+
+    primitive_indices.clear();
+    is_triangle.clear();
+    other_primitive_count = 0;
+}
+
+void ray_tracer_3d::triangle_store::build(const std::vector<primitive*>& mesh, const std::vector<indexed_mesh>& meshes, const std::vector<uint>& order) noexcept
+{
+    const size_t count = order.size();
+
+    clear();
+
+    for (std::vector<float>* stream : { &v0x, &v0y, &v0z, &e1x, &e1y, &e1z, &e2x, &e2y, &e2z })
+        stream->resize(count + PADDING, 0.f);
+
+    primitive_indices = order;
+    is_triangle.resize(count);
+
+    // the triangles of indexed meshes follow the primitives of the mesh
+    for (size_t slot = 0; slot < count; ++slot)
+        if (order[slot] >= mesh.size())
+            is_triangle[slot] = true;
+        else if (!(is_triangle[slot] = mesh[order[slot]]->type == primitive::primitive_type::triangle))
+            ++other_primitive_count;
+
+    update_vertices(mesh, meshes);
+}
+
+void ray_tracer_3d::triangle_store::build(const std::vector<primitive*>& mesh, const std::vector<indexed_mesh>& meshes) noexcept
+{
+    size_t count = mesh.size();
+
+    for (const indexed_mesh& source : meshes)
+        count += source.triangle_count;
+
+    std::vector<uint> order(count);
+
+    std::iota(order.begin(), order.end(), 0);
+
+    build(mesh, meshes, order);
+}
+
+void ray_tracer_3d::triangle_store::update_vertices(const std::vector<primitive*>& mesh, const std::vector<indexed_mesh>& meshes) noexcept
+{
+    const std::vector<size_t> offsets = triangle_offsets(meshes);
+
+    parallel_for(size_t(0), size(), [&](const size_t slot)
+    {
+        if (!is_triangle[slot])
+        {
+            v0x[slot] = v0y[slot] = v0z[slot] = 0.f;
+            e1x[slot] = e1y[slot] = e1z[slot] = 0.f;
+            e2x[slot] = e2y[slot] = e2z[slot] = 0.f;
+
+            return;
+        }
+
+        const uint index = primitive_indices[slot];
+        vec3 a, b, c;
+
+        if (index < mesh.size())
+        {
+            const triangle* const tri = static_cast<const triangle*>(mesh[index]);
+
+            a = tri->A;
+            b = tri->B;
+            c = tri->C;
+        }
+        else
+        {
+            size_t triangle;
+
+            locate_triangle(meshes, offsets, index - mesh.size(), &triangle).triangle_vertices(triangle, &a, &b, &c);
+        }
+
+        const vec3 edge1 = b - a;
+        const vec3 edge2 = c - a;
+
+        v0x[slot] = a.X;
+        v0y[slot] = a.Y;
+        v0z[slot] = a.Z;
+        e1x[slot] = edge1.X;
+        e1y[slot] = edge1.Y;
+        e1z[slot] = edge1.Z;
+        e2x[slot] = edge2.X;
+        e2y[slot] = edge2.Y;
+        e2z[slot] = edge2.Z;
+    });
+}
+
+bool ray_tracer_3d::triangle_store::intersect(const std::vector<primitive*>& mesh, const size_t first, const size_t last, const ray3& ray, hit_test* const __restrict result, primitive** const __restrict hit_primitive) const noexcept
+{
+    const float origin[3] = { ray.origin.X, ray.origin.Y, ray.origin.Z };
+    const float direction[3] = { ray.direction.X, ray.direction.Y, ray.direction.Z };
+    triangle_hit hit = { result->distance, 0.f, 0.f, 0, false };
+    bool found = false;
+
+    if (intersect_triangles(*this, first, last, origin, direction, &hit))
+    {
+        result->distance = hit.distance;
+        result->uv = vec2(hit.u, hit.v);
+        result->type = hit.backface ? hit_test::hit_type::hit : hit_test::hit_type::tangential_hit;
+        result->primitive_index = primitive_indices[hit.slot];
+        *hit_primitive = result->primitive_index < mesh.size() ? mesh[result->primitive_index] : nullptr;
+        found = true;
+    }
+
+    if (other_primitive_count)
+        for (size_t slot = first; slot < last; ++slot)
+            if (!is_triangle[slot])
+            {
+                primitive* const primitive = mesh[primitive_indices[slot]];
+                hit_test local_hit = hit_test();
+
+                primitive->intersect(ray, &local_hit);
+
+                if (local_hit.type != hit_test::hit_type::no_hit && local_hit.distance < result->distance)
+                {
+                    *result = local_hit;
+                    result->primitive_index = primitive_indices[slot];
+                    *hit_primitive = primitive;
+                    found = true;
+                }
+            }
+
+    return found;
+}
+
+bool ray_tracer_3d::triangle_store::occluded(const std::vector<primitive*>& mesh, const size_t first, const size_t last, const ray3& ray, const float max_distance) const noexcept
+{
+    const float origin[3] = { ray.origin.X, ray.origin.Y, ray.origin.Z };
+    const float direction[3] = { ray.direction.X, ray.direction.Y, ray.direction.Z };
+    triangle_hit hit = { max_distance, 0.f, 0.f, 0, false };
+
+    // the kernels work on whole blocks of slots anyway, so they are used as they are instead of stopping at the first hit inside a block
+    if (intersect_triangles(*this, first, last, origin, direction, &hit))
+        return true;
+
+    if (other_primitive_count)
+        for (size_t slot = first; slot < last; ++slot)
+            if (!is_triangle[slot] && mesh[primitive_indices[slot]]->occludes(ray, max_distance))
+                return true;
+
+    return false;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "indexed_mesh.hpp"
+
+
+namespace ray_tracer_3d
+{
+    // Packed structure-of-arrays copy of the scene's triangles used by the intersection hot loop. Each slot stores the triangle's first vertex and its
+    // two precomputed Möller-Trumbore edges (B - A, C - A) as separate float streams. Materials are not copied, but looked up in the scene's table.
+    // The slots are laid out in an arbitrary order given at build time (the leaf order of the acceleration structure), so that a leaf's triangles are
+    // contiguous. Slots of non-triangle primitives are kept degenerate (all zero), which makes them never report a hit.
+    // Slots are filled from the scene's primitive indices: indices below the mesh size refer to 'mesh', all others to the triangles of the indexed meshes.
+    // The float streams are padded with PADDING degenerate slots, so that the SIMD kernels may read full blocks past the last slot.
+    struct triangle_store
+    {
+        static constexpr size_t PADDING = 7;
+        static constexpr float INTERSECTION_EPSILON = EPSILON;
+
+        std::vector<float> v0x, v0y, v0z;
+        std::vector<float> e1x, e1y, e1z;
+        std::vector<float> e2x, e2y, e2z;
+        std::vector<uint> primitive_indices;
+        std::vector<bool> is_triangle;
+        size_t other_primitive_count = 0;
+
+
+        inline size_t size() const noexcept
+        {
+            return primitive_indices.size();
+        }
+
+        void clear() noexcept;
+
+        // (Re-)builds the store from the given primitives. The i-th slot receives the primitive with the index 'order[i]'.
+        void build(const std::vector<primitive*>& mesh, const std::vector<indexed_mesh>& meshes, const std::vector<uint>& order) noexcept;
+
+        // (Re-)builds the store from the given primitives in the order of their indices.
+        void build(const std::vector<primitive*>& mesh, const std::vector<indexed_mesh>& meshes) noexcept;
+
+        // Updates the vertex and edge streams in place. The primitives must still be the ones of the previous build.
+        void update_vertices(const std::vector<primitive*>& mesh, const std::vector<indexed_mesh>& meshes) noexcept;
+
+        // Closest-hit test of the slots [first, last). Triangles are tested by the SIMD kernel selected at startup, all other primitives through the mesh.
+        // 'hit_primitive' receives null for the triangles of indexed meshes, which are only identified by the hit's primitive index.
+        bool intersect(const std::vector<primitive*>& mesh, const size_t first, const size_t last, const ray3& ray, hit_test* const __restrict result, primitive** const __restrict hit_primitive) const noexcept;
+
+        // Any-hit test of the slots [first, last), which returns as soon as one of them is hit closer than 'max_distance'. No hit information is computed.
+        bool occluded(const std::vector<primitive*>& mesh, const size_t first, const size_t last, const ray3& ray, const float max_distance) const noexcept;
+
+        // Möller-Trumbore test of a single slot. This is the scalar reference for the SIMD kernels in 'triangle_kernel.hpp', which follow its exact operation order.
+        // The ray is passed as separate components so that the caller can reuse them across slots.
+        inline bool intersect(
+            const size_t slot,
+            const float* const __restrict origin,
+            const float* const __restrict direction,
+            float* const __restrict t,
+            float* const __restrict u,
+            float* const __restrict v,
+            bool* const __restrict hit_backface
+        ) const noexcept
+        {
+            // h = direction x edge2
+            const float hx = direction[1] * e2z[slot] - direction[2] * e2y[slot];
+            const float hy = direction[2] * e2x[slot] - direction[0] * e2z[slot];
+            const float hz = direction[0] * e2y[slot] - direction[1] * e2x[slot];
+            const float a = e1x[slot] * hx + e1y[slot] * hy + e1z[slot] * hz;
+
+            *hit_backface = a < -INTERSECTION_EPSILON;
+
+            if (a > -INTERSECTION_EPSILON && a < INTERSECTION_EPSILON)
+                return false;
+
+            const float f = 1.f / a;
+            const float sx = origin[0] - v0x[slot];
+            const float sy = origin[1] - v0y[slot];
+            const float sz = origin[2] - v0z[slot];
+
+            *u = f * (sx * hx + sy * hy + sz * hz);
+
+            if (*u < 0.f || *u > 1.f)
+                return false;
+
+            // q = s x edge1
+            const float qx = sy * e1z[slot] - sz * e1y[slot];
+            const float qy = sz * e1x[slot] - sx * e1z[slot];
+            const float qz = sx * e1y[slot] - sy * e1x[slot];
+
+            *v = f * (direction[0] * qx + direction[1] * qy + direction[2] * qz);
+
+            if (*v < 0.f || *u + *v > 1.f)
+                return false;
+
+            *t = f * (e2x[slot] * qx + e2y[slot] * qy + e2z[slot] * qz);
+
+            return *t > INTERSECTION_EPSILON;
+        }
+
+        TO_STRING(triangle_store, "Slots=" << size() << ",Other primitives=" << other_primitive_count);
+    };
+};
@@ -1,4 +1,4 @@
-#include "vec3.hpp"
+#include "affine_transform.hpp"
 
 
 namespace ray_tracer_3d
@@ -8,4 +8,9 @@ namespace ray_tracer_3d
         vec3::UnitX(1, 0, 0),
         vec3::UnitY(0, 1, 0),
         vec3::UnitZ(0, 0, 1);
+
+    vec3 vec3::rotate(const float euler_x, const float euler_y, const float euler_z) const noexcept
+    {
+        return affine_transform::rotation(euler_x, euler_y, euler_z).transform_direction(*this);
+    }
 };
@@ -1,9 +1,10 @@
 ﻿#pragma once
 
-#include "common.hpp"
+#include "vec.hpp"
 
 
 struct ARGB
+    : vec<ARGB, 4>
 {
     static const ARGB BLACK, WHITE, TRANSPARENT, RED, GREEN, BLUE;
 
@@ -34,68 +35,24 @@ struct ARGB
                     ((uint)(std::max(0.f, std::min(B, 1.f)) * 255.f))
                 ) << std::dec);
 
-    inline ARGB operator-() const noexcept
-    {
-        return ARGB(-A, -R, -G, -B);
-    }
-
-    inline ARGB operator+(const ARGB& other) const noexcept
-    {
-        return ARGB(A + other.A, R + other.R, G + other.G, B + other.B);
-    }
-
-    inline ARGB operator-(const ARGB& other) const noexcept
-    {
-        return ARGB(A - other.A, R - other.R, G - other.G, B - other.B);
-    }
-
-    inline ARGB operator*(const float factor) const noexcept
-    {
-        return ARGB(A * factor, R * factor, G * factor, B * factor);
-    }
-
-    inline ARGB operator*(const ARGB& other) const noexcept
-    {
-        return ARGB(A * other.A, R * other.R, G * other.G, B * other.B);
-    }
+    using vec::operator/;
+    using vec::operator/=;
 
+    // Divides every channel by the factor. Unlike the other vectors, colors have always been divided rather than scaled by the reciprocal, which keeps
+    // the rendered images identical to the last bit.
     inline ARGB operator/(const float factor) const
     {
-        return ARGB(A / factor, R / factor, G / factor, B / factor);
-    }
-
-    inline ARGB operator/(const ARGB& other) const noexcept
-    {
-        return ARGB(A / other.A, R / other.R, G / other.G, B / other.B);
-    }
-
-    inline ARGB operator+=(const ARGB& other) const noexcept
-    {
-        return *this + other;
-    }
-
-    inline ARGB operator-=(const ARGB& other) const noexcept
-    {
-        return *this - other;
-    }
-
-    inline ARGB operator*=(const float other) const noexcept
-    {
-        return *this * other;
-    }
-
-    inline ARGB operator/=(const float factor) const
-    {
-        return *this / factor;
+        return from_lanes(lanes() / vec_lanes::splat(factor));
     }
 
-    inline ARGB operator*=(const ARGB& other) const noexcept
+    inline ARGB& operator/=(const float factor)
     {
-        return *this * other;
+        return assign(lanes() / vec_lanes::splat(factor));
     }
 
-    inline ARGB operator/=(const ARGB& factor) const
+    // Returns the relative luminance of the color (Rec. 709 weights), ignoring its alpha.
+    inline float luminance() const noexcept
     {
-        return *this / factor;
+        return .2126f * R + .7152f * G + .0722f * B;
     }
 };
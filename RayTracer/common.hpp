@@ -3,6 +3,7 @@
 #define _USE_MATH_DEFINES
 
 #include <cmath>
+#include <cstdint>
 #include <math.h>
 #include <sstream>
 #include <string>
@@ -15,11 +16,20 @@
 #include <iostream>
 #include <chrono>
 #include <vector>
+#include <limits>
+#include <atomic>
+#include <cstring>
+#include <numeric>
 #include <ctime>
-#include <ppl.h>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <future>
+#include <iomanip>
 
 
 #define EPSILON 1e-6
+#undef INFINITY
 #define INFINITY 1e7
 
 #define RAD2DEG(x) ((x) * 57.2957795131f)
@@ -34,6 +44,14 @@
 
 #define NAMEOF(x) #x
 
+#ifdef _MSC_VER
+#define DLL_EXPORT __declspec(dllexport)
+#define CDECL __cdecl
+#else
+#define DLL_EXPORT __attribute__((visibility("default")))
+#define CDECL
+#endif
+
 #define CPP_IS_FUCKING_RETARDED(x) inline x& operator =(const x& value) noexcept { return this == &value ? *this : *new(this)x(value); }
 #define OSTREAM_OPERATOR(x) \
     friend inline std::ostream& operator<<(std::ostream& os, const x& value) \
@@ -58,7 +76,6 @@
     }
 
 
-typedef unsigned long long ulong;
 typedef unsigned int uint;
 
 
@@ -0,0 +1,98 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+mapped_file::~mapped_file() noexcept
+{
+#ifdef _WIN32
+    if (_data)
+        UnmapViewOfFile(_data);
+
+    if (_mapping)
+        CloseHandle(_mapping);
+#else
+    if (_data)
+        munmap(const_cast<char*>(_data), _size);
+#endif
+}
+
+std::shared_ptr<mapped_file> mapped_file::open(const char* const path) noexcept
+{
+    std::shared_ptr<mapped_file> file(new mapped_file());
+
+#ifdef _WIN32
+    const int length = MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+    std::wstring wide_path(std::max(length, 1), L'\0');
+
+    if (!length || !MultiByteToWideChar(CP_UTF8, 0, path, -1, wide_path.data(), length))
+        return nullptr;
+
+    const HANDLE handle = CreateFileW(wide_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    LARGE_INTEGER size;
+
+    if (handle == INVALID_HANDLE_VALUE)
+        return nullptr;
+    else if (!GetFileSizeEx(handle, &size))
+    {
+        CloseHandle(handle);
+
+        return nullptr;
+    }
+
+    file->_size = size_t(size.QuadPart);
+
+    // the mapping keeps the file open by itself, so the file handle is not needed any longer
+    if (file->_size)
+    {
+        file->_mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+        if (file->_mapping)
+            file->_data = static_cast<const char*>(MapViewOfFile(file->_mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+
+    CloseHandle(handle);
+#else
+    const int handle = ::open(path, O_RDONLY | O_CLOEXEC);
+    struct stat status;
+
+    if (handle < 0)
+        return nullptr;
+    else if (fstat(handle, &status))
+    {
+        close(handle);
+
+        return nullptr;
+    }
+
+    file->_size = size_t(status.st_size);
+
+    if (file->_size)
+    {
+        void* const data = mmap(nullptr, file->_size, PROT_READ, MAP_PRIVATE, handle, 0);
+
+        if (data != MAP_FAILED)
+        {
+            // the file is usually read front to back while the scene is built
+            madvise(data, file->_size, MADV_SEQUENTIAL);
+            file->_data = static_cast<const char*>(data);
+        }
+    }
+
+    close(handle);
+#endif
+
+    if (file->_size && !file->_data)
+        return nullptr;
+
+    return file;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "common.hpp"
+
+
+// Read-only memory mapping of a whole file. The pages are loaded by the operating system on first access, so opening even a very large file costs
+// no more than a few system calls, and its contents can be used in place without being copied.
+class mapped_file
+{
+    const char* _data = nullptr;
+    size_t _size = 0;
+#ifdef _WIN32
+    void* _mapping = nullptr;
+#endif
+
+    mapped_file() noexcept = default;
+
+public:
+    mapped_file(const mapped_file&) = delete;
+
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    ~mapped_file() noexcept;
+
+    // Maps the file with the given UTF-8 encoded path. Returns null if the file cannot be opened or mapped. Empty files are mapped without any data.
+    static std::shared_ptr<mapped_file> open(const char* const path) noexcept;
+
+    inline const char* data() const noexcept
+    {
+        return _data;
+    }
+
+    inline size_t size() const noexcept
+    {
+        return _size;
+    }
+
+    TO_STRING(mapped_file, "Size=" << _size);
+};
@@ -21,9 +21,9 @@ struct material
         return DiffuseColor.A;
     }
 
-    static inline const material& diffuse(const ARGB& color) noexcept
+    static inline material diffuse(const ARGB& color) noexcept
     {
-        material mat;
+        material mat = material();
         mat.DiffuseColor = color;
         mat.SpecularColor = ARGB::TRANSPARENT;
         mat.EmissiveColor = ARGB::TRANSPARENT;
@@ -31,18 +31,18 @@ struct material
         return mat;
     }
 
-    static inline const material& reflective(const ARGB& base, const float reflectiveness) noexcept
+    static inline material reflective(const ARGB& base, const float reflectiveness) noexcept
     {
-        material mat;
+        material mat = material();
         mat.DiffuseColor = base;
         mat.Reflectiveness = reflectiveness;
 
         return mat;
     }
 
-    static inline const material& emissive(const ARGB& base, const float intensity) noexcept
+    static inline material emissive(const ARGB& base, const float intensity) noexcept
     {
-        material mat;
+        material mat = material();
         mat.DiffuseColor = base;
         mat.EmissiveColor = base;
         mat.EmissiveIntensity = intensity;
@@ -0,0 +1,182 @@
+#include "pixel_encoder.hpp"
+
+
+// Lookup tables of the sRGB encoding. Linear values are split into buckets by their exponent and the upper 8 bits of their mantissa. An 8 bit step of the
+// sRGB curve always spans more than one bucket, so the encoding of a value is either the encoding of its bucket's start or the next one. One comparison
+// with the smallest value of that next encoding therefore yields the exactly rounded result.
+struct srgb8_table
+{
+    // values below 2^-13 encode to zero, values from 1 upwards to 255
+    static constexpr float MINIMUM = 1.f / 8192.f;
+    static constexpr uint32_t FIRST_BUCKET = (127 - 13) << 8;
+    static constexpr uint32_t BUCKET_COUNT = (127 << 8) - FIRST_BUCKET;
+
+    uint8_t bucket_start[BUCKET_COUNT];
+    // the smallest linear value of every encoding. the last entry is never reached.
+    float threshold[257];
+
+
+    srgb8_table() noexcept
+    {
+        for (uint32_t bucket = 0; bucket < BUCKET_COUNT; ++bucket)
+        {
+            const uint32_t bits = (bucket + FIRST_BUCKET) << 15;
+            float start;
+
+            std::memcpy(&start, &bits, sizeof(float));
+            bucket_start[bucket] = encode(start);
+        }
+
+        threshold[0] = 0;
+        threshold[256] = std::numeric_limits<float>::max();
+
+        for (int value = 1; value < 256; ++value)
+        {
+            const double srgb = (value - .5) / 255;
+            float linear = float(srgb <= .04045 ? srgb / 12.92 : std::pow((srgb + .055) / 1.055, 2.4));
+
+            // the inverse is only approximate in float precision, so the threshold is moved onto the exact boundary
+            while (encode(linear) >= value)
+                linear = std::nextafter(linear, 0.f);
+
+            while (encode(linear) < value)
+                linear = std::nextafter(linear, 2.f);
+
+            threshold[value] = linear;
+        }
+    }
+
+    // exactly rounded reference encoding
+    static uint8_t encode(const float linear) noexcept
+    {
+        const double x = std::max(0., std::min(1., double(linear)));
+        const double srgb = x <= .0031308 ? x * 12.92 : 1.055 * std::pow(x, 1 / 2.4) - .055;
+
+        return uint8_t(std::floor(srgb * 255 + .5));
+    }
+};
+
+static const srgb8_table SRGB8_TABLE;
+
+
+uint8_t pixel_encoder::to_srgb8(const float linear) noexcept
+{
+    // also catches NaN
+    if (!(linear >= srgb8_table::MINIMUM))
+        return 0;
+    else if (linear >= 1)
+        return 255;
+
+    uint32_t bits;
+
+    std::memcpy(&bits, &linear, sizeof(float));
+
+    const uint8_t value = SRGB8_TABLE.bucket_start[(bits >> 15) - srgb8_table::FIRST_BUCKET];
+
+    return value + (linear >= SRGB8_TABLE.threshold[value + 1]);
+}
+
+uint16_t pixel_encoder::to_half(const float value) noexcept
+{
+    // see Fabian Giesen's 'float_to_half_fast3_rtne'
+    constexpr uint32_t INFINITE = 255 << 23;
+    constexpr uint32_t HALF_MAXIMUM = (127 + 16) << 23;
+    constexpr uint32_t DENORMAL_MAGIC = ((127 - 15) + (23 - 10) + 1) << 23;
+    uint32_t bits;
+
+    std::memcpy(&bits, &value, sizeof(float));
+
+    const uint32_t sign = bits & 0x80000000u;
+    uint16_t half;
+
+    bits ^= sign;
+
+    if (bits >= HALF_MAXIMUM)
+        half = bits > INFINITE ? 0x7e00 : 0x7c00;
+    else if (bits < (113 << 23))
+    {
+        // denormal results are rounded by the float addition
+        float shifted;
+        float magic;
+
+        std::memcpy(&shifted, &bits, sizeof(float));
+        std::memcpy(&magic, &DENORMAL_MAGIC, sizeof(float));
+        shifted += magic;
+        std::memcpy(&bits, &shifted, sizeof(float));
+        half = uint16_t(bits - DENORMAL_MAGIC);
+    }
+    else
+    {
+        const uint32_t odd_mantissa = (bits >> 13) & 1;
+
+        bits += (uint32_t(15 - 127) << 23) + 0xfff + odd_mantissa;
+        half = uint16_t(bits >> 13);
+    }
+
+    return half | uint16_t(sign >> 16);
+}
+
+static inline float tonemap_channel(const tonemap_operator tonemap, const float value) noexcept
+{
+    const float x = std::max(0.f, value);
+
+    switch (tonemap)
+    {
+        case reinhard:
+            return x / (1 + x);
+        case aces_filmic:
+            return x * (2.51f * x + .03f) / (x * (2.43f * x + .59f) + .14f);
+        default:
+            return value;
+    }
+}
+
+ARGB pixel_encoder::map(const ARGB& color) const noexcept
+{
+    return ARGB(
+        color.A,
+        tonemap_channel(tonemap, color.R * exposure_scale),
+        tonemap_channel(tonemap, color.G * exposure_scale),
+        tonemap_channel(tonemap, color.B * exposure_scale)
+    );
+}
+
+void pixel_encoder::encode(const ARGB* const __restrict colors, const size_t count, void* const __restrict destination) const noexcept
+{
+    if (format == bgra8_srgb)
+    {
+        uint8_t* const pixels = static_cast<uint8_t*>(destination);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const ARGB color = map(colors[i]);
+            const float alpha = std::max(0.f, std::min(color.A, 1.f));
+
+            pixels[i * 4] = to_srgb8(color.B);
+            pixels[i * 4 + 1] = to_srgb8(color.G);
+            pixels[i * 4 + 2] = to_srgb8(color.R);
+            pixels[i * 4 + 3] = uint8_t(alpha * 255 + .5f);
+        }
+    }
+    else if (format == rgba16f)
+    {
+        uint16_t* const pixels = static_cast<uint16_t*>(destination);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const ARGB color = map(colors[i]);
+
+            pixels[i * 4] = to_half(color.R);
+            pixels[i * 4 + 1] = to_half(color.G);
+            pixels[i * 4 + 2] = to_half(color.B);
+            pixels[i * 4 + 3] = to_half(color.A);
+        }
+    }
+    else
+    {
+        ARGB* const pixels = static_cast<ARGB*>(destination);
+
+        for (size_t i = 0; i < count; ++i)
+            pixels[i] = map(colors[i]);
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "argb.hpp"
+
+
+// Memory layout of the pixels a render writes into its output buffer.
+enum framebuffer_format
+{
+    // four 32 bit floats in the order of the 'ARGB' struct (16 bytes per pixel)
+    argb32f,
+    // four bytes in the order blue, green, red, alpha with sRGB encoded color channels and a linear alpha channel (4 bytes per pixel). on little-endian
+    // machines every pixel reads as the 32 bit value 0xAARRGGBB, which is the layout of 32 bit ARGB bitmaps on Windows.
+    bgra8_srgb,
+    // four 16 bit floats in the order red, green, blue, alpha (8 bytes per pixel)
+    rgba16f,
+};
+
+// Tone mapping operator, which compresses the color channels before they are written into the output buffer. The alpha channel is never tone mapped.
+enum tonemap_operator
+{
+    // leaves the colors unchanged. 8 bit formats clamp them to [0, 1].
+    identity,
+    // c / (1 + c)
+    reinhard,
+    // the curve fit of the ACES filmic tone mapping by Krzysztof Narkowicz
+    aces_filmic,
+};
+
+// Converts rendered colors into a framebuffer format. The exposure scale and the tone mapping are applied on the way, so that a render resolves its
+// samples into the output buffer in a single pass instead of writing float colors, which the host then converts again.
+struct pixel_encoder
+{
+    framebuffer_format format;
+    tonemap_operator tonemap;
+    float exposure_scale;
+
+
+    // Creates an encoder which scales the colors by 2^exposure (in stops) before tone mapping them.
+    pixel_encoder(const framebuffer_format format, const tonemap_operator tonemap, const float exposure) noexcept
+        : format(format)
+        , tonemap(tonemap)
+        , exposure_scale(std::exp2(exposure))
+    {
+    }
+
+    // Returns the number of bytes of one pixel.
+    inline size_t pixel_size() const noexcept
+    {
+        return format == bgra8_srgb ? 4 : format == rgba16f ? 8 : sizeof(ARGB);
+    }
+
+    // Returns the exposed and tone mapped color.
+    ARGB map(const ARGB& color) const noexcept;
+
+    // Encodes 'count' consecutive colors into 'count' consecutive pixels starting at 'destination'.
+    void encode(const ARGB* const __restrict colors, const size_t count, void* const __restrict destination) const noexcept;
+
+    // Returns the 8 bit sRGB encoding of the linear value, which is clamped to [0, 1]. The result is exactly rounded.
+    static uint8_t to_srgb8(const float linear) noexcept;
+
+    // Returns the IEEE 754 half precision encoding of the value, rounded to nearest even.
+    static uint16_t to_half(const float value) noexcept;
+
+    TO_STRING(pixel_encoder, "Format=" << format << ",Tonemap=" << tonemap << ",Scale=" << exposure_scale);
+};
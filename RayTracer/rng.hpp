@@ -0,0 +1,62 @@
+#pragma once
+
+#include "common.hpp"
+
+
+// PCG32 random number generator (XSH-RR output function, see pcg-random.org). It is small enough to live on the stack of every render thread.
+// Generators are not shared between threads: instead, one is derived from a frame seed and the pixel and sample indices for every sample ('for_sample').
+// This makes the random sequence a pure function of these counters, so renders are reproducible at any thread count and in any tile order.
+struct pcg32
+{
+    static constexpr uint64_t MULTIPLIER = 6364136223846793005ull;
+
+    uint64_t state;
+    uint64_t increment;
+
+
+    pcg32() noexcept : pcg32(0) {}
+
+    pcg32(const uint64_t seed, const uint64_t stream = 0) noexcept
+        : state(0)
+        , increment((stream << 1) | 1)
+    {
+        next_uint();
+        state += seed;
+        next_uint();
+    }
+
+    static inline pcg32 for_sample(const uint64_t frame_seed, const uint64_t pixel_index, const uint64_t sample_index) noexcept
+    {
+        return pcg32(mix(frame_seed ^ mix(pixel_index)), sample_index);
+    }
+
+    inline uint32_t next_uint() noexcept
+    {
+        const uint64_t old = state;
+
+        state = old * MULTIPLIER + increment;
+
+        const uint32_t xorshifted = uint32_t(((old >> 18) ^ old) >> 27);
+        const uint32_t rotation = uint32_t(old >> 59);
+
+        return (xorshifted >> rotation) | (xorshifted << ((32 - rotation) & 31));
+    }
+
+    // Returns a uniformly distributed float in [0, 1).
+    inline float next_float() noexcept
+    {
+        // the upper 24 bits fill the float's mantissa exactly
+        return (next_uint() >> 8) * (1.f / 16777216.f);
+    }
+
+    // SplitMix64 finalizer, which turns consecutive counters into uncorrelated seeds.
+    static constexpr uint64_t mix(uint64_t x) noexcept
+    {
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+
+        return x ^ (x >> 31);
+    }
+
+    TO_STRING(pcg32, "State=" << state << ",Inc=" << increment);
+};
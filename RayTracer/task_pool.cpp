@@ -0,0 +1,148 @@
+#include "task_pool.hpp"
+
+
+task_pool::task_pool() noexcept
+{
+    reserve(std::max(int(std::thread::hardware_concurrency()), 1));
+}
+
+task_pool::~task_pool() noexcept
+{
+    _stopping = true;
+    ++_epoch;
+    _epoch.notify_all();
+
+    for (std::thread& worker : _workers)
+        worker.join();
+}
+
+task_pool& task_pool::instance() noexcept
+{
+    static task_pool pool;
+
+    return pool;
+}
+
+void task_pool::reserve(const int thread_count) noexcept
+{
+    std::lock_guard<std::mutex> lock(_workers_mutex);
+
+    // the calling thread always takes part in its own jobs, so one thread less is needed
+    while (int(_workers.size()) < thread_count - 1)
+    {
+        _workers.emplace_back(&task_pool::worker_main, this, uint(_workers.size()));
+        ++_worker_count;
+    }
+}
+
+void task_pool::worker_main(const uint worker) noexcept
+{
+    while (!_stopping)
+    {
+        if (help_any(worker % MAX_JOBS))
+            continue;
+
+        // the epoch is read before looking for jobs a second time, so that a job published in between changes it and the wait returns immediately
+        ++_sleeping;
+
+        const uint epoch = _epoch.load();
+
+        if (!_stopping && !help_any(worker % MAX_JOBS))
+            _epoch.wait(epoch);
+
+        --_sleeping;
+    }
+}
+
+bool task_pool::help(job_slot& slot) noexcept
+{
+    bool worked = false;
+
+    ++slot.users;
+
+    if (slot.state.load() == slot_active)
+        for (size_t first; (first = slot.next.fetch_add(slot.chunk_size, std::memory_order_relaxed)) < slot.end; worked = true)
+        {
+            const size_t last = std::min(first + slot.chunk_size, slot.end);
+
+            slot.invoke(slot.context, first, last);
+            slot.completed.fetch_add(last - first, std::memory_order_release);
+        }
+
+    --slot.users;
+
+    return worked;
+}
+
+bool task_pool::help_any(const uint first_slot) noexcept
+{
+    bool worked = false;
+
+    for (uint offset = 0; offset < MAX_JOBS; ++offset)
+    {
+        job_slot& slot = _slots[(first_slot + offset) % MAX_JOBS];
+
+        if (slot.state.load(std::memory_order_relaxed) == slot_active)
+            worked |= help(slot);
+    }
+
+    return worked;
+}
+
+void task_pool::run(const size_t begin, const size_t end, size_t chunk_size, void (*invoke)(const void*, const size_t, const size_t), const void* context) noexcept
+{
+    const size_t count = end - begin;
+
+    if (!chunk_size)
+        chunk_size = std::max(count / (thread_count() * CHUNKS_PER_THREAD), size_t(1));
+
+    // single chunks or a single thread are not worth publishing
+    if (chunk_size >= count || thread_count() == 1)
+    {
+        invoke(context, begin, end);
+
+        return;
+    }
+
+    for (uint index = 0; index < MAX_JOBS; ++index)
+    {
+        job_slot& slot = _slots[index];
+        uint expected = slot_free;
+
+        if (!slot.state.compare_exchange_strong(expected, slot_setup, std::memory_order_acquire))
+            continue;
+
+        slot.next.store(begin, std::memory_order_relaxed);
+        slot.completed.store(0, std::memory_order_relaxed);
+        slot.end = end;
+        slot.chunk_size = chunk_size;
+        slot.invoke = invoke;
+        slot.context = context;
+        slot.state.store(slot_active, std::memory_order_release);
+
+        ++_epoch;
+
+        if (_sleeping)
+            _epoch.notify_all();
+
+        // the calling thread works on its own job first and helps with other jobs while the remaining chunks are being completed elsewhere
+        help(slot);
+
+        while (slot.completed.load(std::memory_order_acquire) < count)
+            if (!help_any(index + 1))
+                std::this_thread::yield();
+
+        // late helpers may still be inside the slot (without finding any work), so the slot is only released once they have left
+        slot.state.store(slot_retiring);
+
+        while (slot.users.load())
+            std::this_thread::yield();
+
+        slot.state.store(slot_free, std::memory_order_release);
+
+        return;
+    }
+
+    // all slots are taken, which only happens for deeply nested jobs. their iterations are simply run on the calling thread.
+    invoke(context, begin, end);
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "common.hpp"
+
+
+// Portable pool of worker threads, which executes parallel loops. A loop is published as a job into one of MAX_JOBS fixed slots and its iterations are
+// claimed in chunks through an atomic counter by the pool's workers as well as by the calling thread, which always helps with its own job. No locks are taken
+// on the way: publishing, claiming and retiring a job are atomic operations only. Workers which run out of jobs sleep on an atomic epoch counter.
+// Jobs may be nested freely, as every caller keeps processing work (its own job first, then any other) until its job has been completed.
+class task_pool
+{
+public:
+    static constexpr int MAX_JOBS = 64;
+    // the automatic chunk size hands out roughly this many chunks per thread, which balances the load without contending too much on the counter
+    static constexpr size_t CHUNKS_PER_THREAD = 8;
+
+private:
+    enum job_state : uint
+    {
+        slot_free,
+        slot_setup,
+        slot_active,
+        slot_retiring,
+    };
+
+    struct alignas(64) job_slot
+    {
+        std::atomic<uint> state = slot_free;
+        // number of threads currently looking at the slot. a slot is only reused once this has dropped to zero.
+        std::atomic<uint> users = 0;
+        std::atomic<size_t> next = 0;
+        std::atomic<size_t> completed = 0;
+        size_t end = 0;
+        size_t chunk_size = 1;
+        void (*invoke)(const void*, const size_t, const size_t) = nullptr;
+        const void* context = nullptr;
+    };
+
+    job_slot _slots[MAX_JOBS];
+    std::vector<std::thread> _workers;
+    std::mutex _workers_mutex;
+    std::atomic<int> _worker_count = 0;
+    std::atomic<uint> _epoch = 0;
+    std::atomic<uint> _sleeping = 0;
+    std::atomic<bool> _stopping = false;
+
+    task_pool() noexcept;
+
+    void worker_main(const uint worker) noexcept;
+
+    // processes chunks of the job in the given slot until none are left. returns whether any chunk has been processed.
+    bool help(job_slot& slot) noexcept;
+
+    // helps any published job, starting the search at the given slot. returns whether any chunk has been processed.
+    bool help_any(const uint first_slot) noexcept;
+
+    void run(const size_t begin, const size_t end, size_t chunk_size, void (*invoke)(const void*, const size_t, const size_t), const void* context) noexcept;
+public:
+    ~task_pool() noexcept;
+
+    task_pool(const task_pool&) = delete;
+    task_pool& operator =(const task_pool&) = delete;
+
+    static task_pool& instance() noexcept;
+
+    // number of threads taking part in a job, i.e. the workers plus the calling thread
+    inline int thread_count() const noexcept
+    {
+        return _worker_count + 1;
+    }
+
+    // Grows the pool, so that at least 'thread_count' threads take part in every job. The pool is never shrunk.
+    void reserve(const int thread_count) noexcept;
+
+    // Calls 'func(index)' for every index in [begin, end) and returns once all calls have completed. A 'chunk_size' of zero selects an automatic chunk size.
+    template<typename I, typename F>
+    void parallel_for(const I begin, const I end, const F& func, const size_t chunk_size = 0) noexcept
+    {
+        if (end <= begin)
+            return;
+
+        run(size_t(begin), size_t(end), chunk_size, [](const void* context, const size_t first, const size_t last)
+        {
+            const F& func = *static_cast<const F*>(context);
+
+            for (size_t index = first; index < last; ++index)
+                func(I(index));
+        }, &func);
+    }
+
+    template<typename F1, typename F2>
+    void parallel_invoke(const F1& first, const F2& second) noexcept
+    {
+        parallel_for(0, 2, [&](const int index)
+        {
+            if (index)
+                second();
+            else
+                first();
+        }, 1);
+    }
+
+    TO_STRING(task_pool, "Threads=" << thread_count());
+};
+
+
+template<typename I, typename F>
+inline void parallel_for(const I begin, const I end, const F& func, const size_t chunk_size = 0) noexcept
+{
+    task_pool::instance().parallel_for(begin, end, func, chunk_size);
+}
+
+template<typename F1, typename F2>
+inline void parallel_invoke(const F1& first, const F2& second) noexcept
+{
+    task_pool::instance().parallel_invoke(first, second);
+}
@@ -0,0 +1,130 @@
+#include "3D/ray_tracer.hpp"
+
+using namespace ray_tracer_3d;
+
+
+// Progressive rendering must converge to the image of a regular render: the first N passes trace the same samples as a render of N samples per pixel,
+// and both place them on top of the background color. The sums of the accumulation buffer are kept in double precision, which is why the images are
+// compared with a small tolerance.
+static constexpr float TOLERANCE = 1e-4f;
+
+static int failures = 0;
+
+
+static void check(const bool condition, const std::string& message)
+{
+    if (!condition)
+    {
+        std::cerr << "FAILED: " << message << std::endl;
+        ++failures;
+    }
+}
+
+static render_configuration make_configuration(const size_t samples) noexcept
+{
+    render_configuration config = render_configuration();
+
+    config.horizontal_resolution = 32;
+    config.vertical_resolution = 24;
+    config.subpixels_per_pixel = 1;
+    config.samples_per_subpixel = samples;
+    config.maximum_iteration_count = 8;
+    config.camera.position = vec3(0, 0, 18);
+    config.camera.look_at = vec3(0, 3, 0);
+    config.camera.zoom_factor = 2;
+    config.camera.focal_length = 1;
+    config.mode = render_mode::realistic_colors;
+    config.background_color = ARGB(.5f, .25f, .125f, 1);
+    config.air_refraction_index = 1;
+    config.output_format = argb32f;
+    config.thread_count = 1;
+
+    return config;
+}
+
+static std::vector<ARGB> render_regular(const scene* const scene, const size_t samples)
+{
+    const render_configuration config = make_configuration(samples);
+    std::vector<ARGB> image(config.horizontal_resolution * config.vertical_resolution);
+
+    RenderImage3(scene, config, image.data());
+
+    return image;
+}
+
+static std::vector<ARGB> render_progressive(const scene* const scene, accumulation_buffer* const buffer, const size_t passes)
+{
+    const render_configuration config = make_configuration(passes);
+    std::vector<ARGB> image(config.horizontal_resolution * config.vertical_resolution);
+
+    for (size_t pass = 0; pass < passes; ++pass)
+        RenderProgressive3(scene, config, buffer);
+
+    ResolveAccumulationBuffer3(buffer, image.data());
+
+    return image;
+}
+
+static void compare_images(const std::vector<ARGB>& expected, const std::vector<ARGB>& actual, const std::string& name)
+{
+    size_t differing = 0;
+
+    for (size_t i = 0; i < expected.size(); ++i)
+        for (int channel = 0; channel < 4; ++channel)
+            if (std::abs(expected[i][channel] - actual[i][channel]) > TOLERANCE)
+            {
+                ++differing;
+                break;
+            }
+
+    check(!differing, name + ": " + std::to_string(differing) + " of " + std::to_string(expected.size()) + " pixels differ");
+}
+
+int main()
+{
+    // an empty scene shows nothing but the background
+    scene* const empty = new scene();
+    accumulation_buffer* const buffer = CreateAccumulationBuffer3();
+
+    for (const size_t samples : { 1, 4 })
+        compare_images(render_regular(empty, samples), render_progressive(empty, buffer, samples), "empty scene, " + std::to_string(samples) + " samples");
+
+    DeleteScene3(empty);
+
+    // a new scene is never mistaken for a deleted one, even if it has been allocated at the same address
+    scene* const reused = new scene();
+
+    RenderProgressive3(reused, make_configuration(1), buffer);
+    check(GetAccumulatedSampleCount3(buffer) == 1, "the first pass of a new scene restarts the accumulation");
+    DeleteScene3(reused);
+
+    scene* const demo = CreateScene3();
+
+    for (const size_t samples : { 1, 4 })
+    {
+        // restart accumulation, as the passes of the previous iteration belong to the same frame
+        ResetAccumulationBuffer3(buffer);
+        compare_images(render_regular(demo, samples), render_progressive(demo, buffer, samples), "demo scene, " + std::to_string(samples) + " samples");
+    }
+
+    // editing a material restarts the accumulation, whose samples would otherwise show the old material
+    material mat;
+
+    check(GetMaterial3(demo, 1, &mat), "the demo scene has a second material");
+    mat.DiffuseColor = ARGB::GREEN;
+    check(SetMaterial3(demo, 1, mat), "the material can be set");
+    check(GetAccumulatedSampleCount3(buffer) == 4, "the accumulated passes are kept until the next pass");
+    RenderProgressive3(demo, make_configuration(1), buffer);
+    check(GetAccumulatedSampleCount3(buffer) == 1, "the pass after a material edit restarts the accumulation");
+
+    ResetAccumulationBuffer3(buffer);
+    compare_images(render_regular(demo, 4), render_progressive(demo, buffer, 4), "demo scene after a material edit");
+
+    DeleteAccumulationBuffer3(buffer);
+    DeleteScene3(demo);
+
+    if (failures)
+        std::cerr << failures << " check(s) failed" << std::endl;
+
+    return failures ? 1 : 0;
+}
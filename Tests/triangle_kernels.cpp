@@ -0,0 +1,188 @@
+#include "3D/ray_tracer.hpp"
+#include "3D/triangle_kernel.hpp"
+
+#include <bit>
+
+using namespace ray_tracer_3d;
+
+
+// The SIMD triangle kernels must produce the same hits as the scalar reference down to the last bit, as the renderer's output would otherwise depend on
+// the CPU it runs on. The store holds 16 blocks of 8 slots and one more, so that the last block of the AVX2 kernel reads 7 padding slots.
+static constexpr size_t SLOT_COUNT = 16 * 8 + 1;
+static constexpr size_t RANDOM_RAY_COUNT = 2000;
+
+static int failures = 0;
+
+
+static void check(const bool condition, const std::string& message)
+{
+    if (!condition)
+    {
+        std::cerr << "FAILED: " << message << std::endl;
+        ++failures;
+    }
+}
+
+static vec3 random_point(pcg32* const rng, const float extent) noexcept
+{
+    return vec3(extent * (2 * rng->next_float() - 1), extent * (2 * rng->next_float() - 1), extent * (2 * rng->next_float() - 1));
+}
+
+// Creates random triangles within [-1, 1]³, interspersed with degenerate ones (coincident or collinear vertices), spheres (whose slots are all zero),
+// exact duplicates of earlier triangles (whose hits tie with them) and triangles in the plane z = 0, which the edge-on rays run through.
+static std::vector<primitive*> create_primitives()
+{
+    pcg32 rng(4);
+    std::vector<primitive*> primitives;
+
+    for (size_t i = 0; i < SLOT_COUNT; ++i)
+    {
+        const vec3 a = random_point(&rng, 1);
+        const vec3 b = random_point(&rng, 1);
+        const vec3 c = random_point(&rng, 1);
+
+        if (i % 11 == 3)
+            primitives.push_back(new triangle(a, a, a));
+        else if (i % 11 == 7)
+            primitives.push_back(new triangle(a, a.add(b).scale(.5f), b));
+        else if (i % 17 == 5)
+            primitives.push_back(new sphere(a, .5f));
+        else if (i % 13 == 9)
+        {
+            // a duplicate of the closest preceding triangle, which usually lies within the same block of slots, or of the first one
+            size_t original = i % 2 ? i - 1 : 0;
+
+            while (primitives[original]->type != primitive::primitive_type::triangle)
+                --original;
+
+            const triangle* const tri = static_cast<const triangle*>(primitives[original]);
+
+            primitives.push_back(new triangle(tri->A, tri->B, tri->C));
+        }
+        else if (i % 5 == 1)
+            primitives.push_back(new triangle(vec3(a.X, a.Y, 0), vec3(b.X, b.Y, 0), vec3(c.X, c.Y, 0)));
+        else
+            primitives.push_back(new triangle(a, b, c));
+    }
+
+    return primitives;
+}
+
+// Rays from a sphere of radius 4 towards random points within [-1, 1]³, rays aimed exactly at the vertices of triangles, whose barycentric coordinates
+// lie on the edges of their valid range, and edge-on rays within the plane z = 0.
+static std::vector<ray3> create_rays(const std::vector<primitive*>& primitives)
+{
+    pcg32 rng(5);
+    std::vector<ray3> rays;
+
+    for (size_t i = 0; i < RANDOM_RAY_COUNT; ++i)
+    {
+        const vec3 origin = random_point(&rng, 1).normalize().scale(4);
+
+        rays.emplace_back(origin, random_point(&rng, 1).sub(origin));
+    }
+
+    for (const primitive* const primitive : primitives)
+        if (primitive->type == primitive::primitive_type::triangle)
+        {
+            const triangle* const tri = static_cast<const triangle*>(primitive);
+            const vec3 origin = random_point(&rng, 1).normalize().scale(4);
+
+            for (const vec3& vertex : { tri->A, tri->B, tri->C })
+                rays.emplace_back(origin, vertex.sub(origin));
+        }
+
+    for (size_t i = 0; i < 64; ++i)
+    {
+        const vec3 origin = random_point(&rng, 1);
+        const vec3 target = random_point(&rng, 1);
+
+        rays.emplace_back(vec3(origin.X, origin.Y, 0), vec3(target.X - origin.X, target.Y - origin.Y, 0));
+    }
+
+    return rays;
+}
+
+static bool same_bits(const float a, const float b) noexcept
+{
+    return std::bit_cast<uint32_t>(a) == std::bit_cast<uint32_t>(b);
+}
+
+// Tests the ray against the slots [first, last) with both kernels and compares the results. Returns whether the reference kernel found a hit.
+static bool compare_kernels(const triangle_store& store, const std::string& name, const triangle_kernel kernel, const ray3& ray, const size_t first,
+                            const size_t last, const float max_distance)
+{
+    const float origin[3] = { ray.origin.X, ray.origin.Y, ray.origin.Z };
+    const float direction[3] = { ray.direction.X, ray.direction.Y, ray.direction.Z };
+    triangle_hit expected = { max_distance, 0, 0, ~size_t(0), false };
+    triangle_hit actual = expected;
+    const bool expected_found = intersect_triangles_scalar(store, first, last, origin, direction, &expected);
+    const bool actual_found = kernel(store, first, last, origin, direction, &actual);
+    const bool same = expected_found == actual_found
+                   && same_bits(expected.distance, actual.distance)
+                   && same_bits(expected.u, actual.u)
+                   && same_bits(expected.v, actual.v)
+                   && expected.slot == actual.slot
+                   && expected.backface == actual.backface;
+
+    if (!same)
+    {
+        std::ostringstream message;
+
+        message << std::setprecision(9) << name << " differs from the scalar kernel for the ray " << ray << " and the slots [" << first << ", " << last
+                << "): expected " << expected_found << " at t=" << expected.distance << ", u=" << expected.u << ", v=" << expected.v << ", slot "
+                << expected.slot << ", actual " << actual_found << " at t=" << actual.distance << ", u=" << actual.u << ", v=" << actual.v << ", slot "
+                << actual.slot;
+        check(false, message.str());
+    }
+
+    return expected_found;
+}
+
+int main()
+{
+    const std::vector<primitive*> primitives = create_primitives();
+    const std::vector<ray3> rays = create_rays(primitives);
+    triangle_store store;
+
+    store.build(primitives, {});
+    check(store.size() == SLOT_COUNT && store.v0x.size() == SLOT_COUNT + triangle_store::PADDING, "the store holds every slot and its padding");
+
+    const kernel_isa isa = detect_kernel_isa();
+    std::vector<std::pair<std::string, triangle_kernel>> kernels;
+
+    if (isa == kernel_isa::sse || isa == kernel_isa::avx2)
+        kernels.emplace_back("sse", intersect_triangles_sse);
+
+    if (isa == kernel_isa::avx2)
+        kernels.emplace_back("avx2", intersect_triangles_avx2);
+
+    if (kernels.empty())
+        std::cout << "no SIMD kernel is supported, only the scalar kernel is used" << std::endl;
+
+    // the whole store, unaligned starts, ranges ending within a block and the last slot alone, which is followed by the padding only
+    const std::vector<std::pair<size_t, size_t>> ranges = {
+        { 0, SLOT_COUNT }, { 1, SLOT_COUNT }, { 3, SLOT_COUNT }, { 5, SLOT_COUNT - 1 }, { 8, 15 }, { 9, 10 }, { 0, 4 }, { 2, 9 }, { SLOT_COUNT - 1, SLOT_COUNT },
+        { SLOT_COUNT - 4, SLOT_COUNT }, { SLOT_COUNT - 9, SLOT_COUNT },
+    };
+
+    for (const auto& [name, kernel] : kernels)
+    {
+        size_t hits = 0;
+
+        for (const ray3& ray : rays)
+            for (const auto& [first, last] : ranges)
+                for (const float max_distance : { std::numeric_limits<float>::infinity(), 4.f })
+                    hits += compare_kernels(store, name, kernel, ray, first, last, max_distance);
+
+        check(hits > rays.size(), name + ": the rays hit the triangles " + std::to_string(hits) + " times, which does not cover the kernel");
+    }
+
+    for (const primitive* const primitive : primitives)
+        delete primitive;
+
+    if (failures)
+        std::cerr << failures << " check(s) failed" << std::endl;
+
+    return failures ? 1 : 0;
+}
@@ -1,13 +1,16 @@
 ﻿// #define USE_SETTINGS
 #define SQ
 
+using System.Collections.Generic;
 using System.Drawing.Drawing2D;
 using System.Drawing.Imaging;
 using System.Drawing;
+using System.Runtime.InteropServices;
 using System.Windows.Forms;
 using System.Threading.Tasks;
 using System.Threading;
 using System.Diagnostics;
+using System.Numerics;
 using System;
 
 namespace Visualizer
@@ -42,11 +45,21 @@ namespace Visualizer
         public static Vec3 TARGET = new(0, 3, 0);
         public static unsafe void* SCENE = null;
 
-        private readonly unsafe ARGB[] buffer = new ARGB[WIDTH * HEIGHT];
-        private readonly object _mutex = new();
+        // rendered as sRGB encoded BGRA8 pixels, which is the layout of 'PixelFormat.Format32bppArgb', so that they can be copied into the bitmap as they are.
+        // the buffer is written by background render jobs and therefore stays pinned for the lifetime of the window.
+        private readonly int[] pixels = new int[WIDTH * HEIGHT];
+        private readonly GCHandle pixels_handle;
+        // shown by the picture box. the pixels of finished tiles are copied into it as they come in, so that it never has to be recreated.
+        private readonly Bitmap bitmap = new(WIDTH, HEIGHT, PixelFormat.Format32bppArgb);
+        // guards the job handle against being released while the bitmap updater reads its finished tiles
+        private readonly object job_lock = new();
+        private IntPtr job = IntPtr.Zero;
+        private ulong[] finished_tiles = Array.Empty<ulong>();
+        // tiles of the current job which have already been copied into the bitmap
+        private ulong[] published_tiles = Array.Empty<ulong>();
+        private int tile_size = 0;
+        private int tile_columns = 0;
         private bool window_open = true;
-        private int is_rendering = 0;
-        private int is_pending = 0;
 
 
         public unsafe MainWindow()
@@ -58,9 +71,15 @@ namespace Visualizer
             pictureBox1.InterpolationMode = InterpolationMode.NearestNeighbor;
 
             SCENE = RayTracer.CreateScene3();
+            pixels_handle = GCHandle.Alloc(pixels, GCHandleType.Pinned);
+            pictureBox1.Image = bitmap;
         }
 
-        unsafe ~MainWindow() => RayTracer.DeleteScene3(SCENE);
+        unsafe ~MainWindow()
+        {
+            RayTracer.DeleteScene3(SCENE);
+            pixels_handle.Free();
+        }
 
         private void MainWindow_Load(object sender, EventArgs e)
         {
@@ -98,122 +117,167 @@ namespace Visualizer
             Properties.Settings.Default.Save();
 #endif
             window_open = false;
+            CancelRender();
         }
 
         private async Task Bitmap_Updater()
         {
             while (window_open)
-                if (is_rendering != 0)
-                    unsafe
-                    {
-                        Bitmap bmp = new(WIDTH, HEIGHT, PixelFormat.Format32bppArgb);
-                        BitmapData dat = bmp.LockBits(new(0, 0, WIDTH, HEIGHT), ImageLockMode.ReadWrite, bmp.PixelFormat);
-                        uint* ptr = (uint*)dat.Scan0;
-
-                        Parallel.For(0, WIDTH * HEIGHT, i =>
-                        {
-                            ARGB color = buffer[i];
-                            float a = color.A;
-                            float r = color.R;
-                            float g = color.G;
-                            float b = color.B;
-                            uint b_a = a < 0 ? 0u : a > 1 ? 255u : (uint)(a * 255);
-                            uint b_r = r < 0 ? 0u : r > 1 ? 255u : (uint)(r * 255);
-                            uint b_g = g < 0 ? 0u : g > 1 ? 255u : (uint)(g * 255);
-                            uint b_b = b < 0 ? 0u : b > 1 ? 255u : (uint)(b * 255);
-
-                            ptr[i] = b_a << 24 | b_r << 16 | b_g << 8 | b_b;
-                        });
-
-                        bmp.UnlockBits(dat);
-                        Invoke(new MethodInvoker(delegate
-                        {
-                            using Image? old = pictureBox1.Image;
-
-                            pictureBox1.Image = bmp;
-                            old?.Dispose();
-                        }));
-                    }
-                else
-                    await Task.Delay(15);
+            {
+                List<Rectangle> tiles;
+
+                lock (job_lock)
+                    tiles = CollectFinishedTiles();
+
+                // the bitmap is written on the UI thread, which also paints it, and outside of the lock, as the UI thread may be waiting for it
+                if (tiles.Count > 0)
+                    Invoke(new MethodInvoker(delegate { PublishTiles(tiles); }));
+
+                await Task.Delay(15);
+            }
         }
 
-        private async void button1_Click(object sender, EventArgs e)
+        // Returns the areas of all tiles which the current job has finished since the last call. Must be called while holding 'job_lock'.
+        private List<Rectangle> CollectFinishedTiles()
         {
-            lock (_mutex)
-                if (Interlocked.Exchange(ref is_rendering, 1) != 0)
+            List<Rectangle> tiles = new();
+
+            if (job == IntPtr.Zero)
+                return tiles;
+
+            RayTracer.GetCompletedTiles3(job, finished_tiles, (ulong)finished_tiles.Length);
+
+            for (int word = 0; word < finished_tiles.Length; ++word)
+            {
+                for (ulong bits = finished_tiles[word] & ~published_tiles[word]; bits != 0; bits &= bits - 1)
                 {
-                    Interlocked.Exchange(ref is_pending, 1);
+                    int index = word * 64 + BitOperations.TrailingZeroCount(bits);
+                    int x = index % tile_columns * tile_size;
+                    int y = index / tile_columns * tile_size;
 
-                    return;
+                    tiles.Add(new(x, y, Math.Min(tile_size, WIDTH - x), Math.Min(tile_size, HEIGHT - y)));
                 }
 
-            button1.Enabled = false;
-            progressBar1.Value = 0;
+                published_tiles[word] |= finished_tiles[word];
+            }
 
-            await Task.Factory.StartNew(delegate
+            return tiles;
+        }
+
+        // Copies the rows of the given tiles from the rendered pixels into the bitmap and repaints it. Must be called on the UI thread.
+        private void PublishTiles(List<Rectangle> tiles)
+        {
+            foreach (Rectangle tile in tiles)
             {
-                Stopwatch sw_total = new();
+                BitmapData data = bitmap.LockBits(tile, ImageLockMode.WriteOnly, bitmap.PixelFormat);
 
-                sw_total.Start();
+                for (int y = 0; y < tile.Height; ++y)
+                    Marshal.Copy(pixels, (tile.Y + y) * WIDTH + tile.X, data.Scan0 + y * data.Stride, tile.Width);
 
-                RenderConfiguration config = new()
-                {
-                    Camera = new()
-                    {
-                        Position = EYE,
-                        LookAt = TARGET,
-                        ZoomFactor = ZOOM,
-                        FocalLength = FOCAL_LENGTH,
-                    },
-                    RenderMode = MODE,
-                    HorizontalResolution = WIDTH,
-                    VerticalResolution = HEIGHT,
-                    MaximumIterationCount = MAX_ITER,
-                    SamplesPerSubpixel = (ulong)SAMPLES,
-                    SubpixelsPerPixel = (ulong)SUBPIXELS,
-                    Debug = false,
-                    AirRefractionIndex = 1f,
-                    BackgroundColor = default(ARGB),
-                };
-                float progress = 0;
-                float µs_render = -1;
-                Task.Factory.StartNew(delegate
-                {
-                    while (µs_render < 0)
-                        Invoke(new MethodInvoker(delegate
-                        {
-                            label6.Text = $"{progress * 100:F4} %";
-                            progressBar1.Value = (int)(progress * progressBar1.Maximum);
-                        }));
-                });
-
-                unsafe
+                bitmap.UnlockBits(data);
+            }
+
+            pictureBox1.Invalidate();
+        }
+
+        private unsafe IntPtr StartRender(RenderConfiguration config)
+        {
+            lock (job_lock)
+            {
+                job = RayTracer.StartRender3(SCENE, config, (void*)pixels_handle.AddrOfPinnedObject());
+
+                RayTracer.GetTileGrid3(job, out tile_size, out tile_columns, out int rows);
+                finished_tiles = new ulong[(tile_columns * rows + 63) / 64];
+                published_tiles = new ulong[finished_tiles.Length];
+
+                return job;
+            }
+        }
+
+        // Releases the job after publishing its last finished tiles and returns its render time. Called on the UI thread.
+        private float FinishRender()
+        {
+            List<Rectangle> tiles;
+            float µs;
+
+            lock (job_lock)
+            {
+                tiles = CollectFinishedTiles();
+                µs = RayTracer.WaitRender3(job);
+                job = IntPtr.Zero;
+            }
+
+            PublishTiles(tiles);
+
+            return µs;
+        }
+
+        // Cancels the render in progress (if any) and waits for it to stop, which takes a few milliseconds at most.
+        private void CancelRender()
+        {
+            lock (job_lock)
+                if (job != IntPtr.Zero)
                 {
-                    fixed (ARGB* ptr = buffer)
-                        µs_render = RayTracer.RenderImage3(SCENE, config, ptr, ref progress);
+                    RayTracer.CancelRender3(job);
+                    RayTracer.WaitRender3(job);
+                    job = IntPtr.Zero;
                 }
+        }
 
-                Invoke(new MethodInvoker(delegate
-                {
-                    button1.Enabled = true;
-                    progressBar1.Value = progressBar1.Maximum;
+        private async void button1_Click(object sender, EventArgs e)
+        {
+            // a new request pre-empts the stale render instead of queueing behind it
+            CancelRender();
 
-                    sw_total.Stop();
+            Stopwatch sw_total = new();
 
-                    button1.Text = $"RE-RENDER\nprevious: {sw_total.ElapsedMilliseconds:F4}ms | {µs_render * .001:F4}ms";
-                }));
+            sw_total.Start();
 
-                lock (_mutex)
+            RenderConfiguration config = new()
+            {
+                Camera = new()
                 {
-                    Interlocked.Exchange(ref is_rendering, 0);
+                    Position = EYE,
+                    LookAt = TARGET,
+                    ZoomFactor = ZOOM,
+                    FocalLength = FOCAL_LENGTH,
+                },
+                RenderMode = MODE,
+                HorizontalResolution = WIDTH,
+                VerticalResolution = HEIGHT,
+                MaximumIterationCount = MAX_ITER,
+                SamplesPerSubpixel = (ulong)SAMPLES,
+                SubpixelsPerPixel = (ulong)SUBPIXELS,
+                Debug = false,
+                AirRefractionIndex = 1f,
+                BackgroundColor = default(ARGB),
+                TileOrdering = TileOrder.HilbertCurve,
+                OutputFormat = FramebufferFormat.Bgra8Srgb,
+            };
+            IntPtr current = StartRender(config);
+            float progress = 0;
 
-                    if (Interlocked.Exchange(ref is_pending, 0) == 0)
-                        return;
-                }
+            progressBar1.Value = 0;
+
+            while (RayTracer.PollRender3(current, ref progress) == RenderJobState.Running)
+            {
+                label6.Text = $"{progress * 100:F4} %";
+                progressBar1.Value = (int)(progress * progressBar1.Maximum);
+
+                await Task.Delay(15);
+
+                // the job has been pre-empted and released by a newer render in the meantime
+                if (job != current)
+                    return;
+            }
+
+            float µs_render = FinishRender();
+
+            sw_total.Stop();
 
-                Invoke(new MethodInvoker(() => button1_Click(sender, e)));
-            });
+            label6.Text = $"{progress * 100:F4} %";
+            progressBar1.Value = progressBar1.Maximum;
+            button1.Text = $"RE-RENDER\nprevious: {sw_total.ElapsedMilliseconds:F4}ms | {µs_render * .001:F4}ms";
         }
 
         private void trackBar1_Scroll(object sender, EventArgs e)
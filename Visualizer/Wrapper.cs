@@ -1,4 +1,5 @@
 ﻿using System.Runtime.InteropServices;
+using System;
 
 
 namespace Visualizer
@@ -19,6 +20,43 @@ namespace Visualizer
         RenderTime,
     }
 
+    public enum RayPacketMode
+    {
+        SingleRays,
+        Packets2x2,
+        Packets4x4,
+    }
+
+    public enum TileOrder
+    {
+        Scanline,
+        MortonCurve,
+        HilbertCurve,
+    }
+
+    public enum FramebufferFormat
+    {
+        Argb32f,
+        Bgra8Srgb,
+        Rgba16f,
+    }
+
+    public enum TonemapOperator
+    {
+        Identity,
+        Reinhard,
+        AcesFilmic,
+    }
+
+    public enum RenderJobState
+    {
+        Running,
+        Completed,
+        Cancelled,
+    }
+
+    // the native vector is padded to four floats
+    [StructLayout(LayoutKind.Sequential, Size = 16)]
     public struct Vec3
     {
         public float X, Y, Z;
@@ -31,6 +69,19 @@ namespace Visualizer
         public float A, R, G, B;
     }
 
+    public struct Material
+    {
+        public ARGB DiffuseColor;
+        public ARGB SpecularColor;
+        public ARGB EmissiveColor;
+        public float EmissiveIntensity;
+        public float Specularity;
+        public float SpecularIndex;
+        public float Reflectiveness;
+        public float Refractiveness;
+        public ARGB RefractiveIndex;
+    }
+
     public struct CameraConfiguration
     {
         public Vec3 Position;
@@ -52,6 +103,17 @@ namespace Visualizer
         public bool Debug;
         public ARGB BackgroundColor;
         public float AirRefractionIndex;
+        public RayPacketMode PacketMode;
+        public ulong TileSize;
+        public TileOrder TileOrdering;
+        public ulong ThreadCount;
+        public ulong Seed;
+        public bool RecordHistory;
+        public float AdaptiveThreshold;
+        public ulong AdaptiveMinimumSamples;
+        public FramebufferFormat OutputFormat;
+        public TonemapOperator Tonemap;
+        public float Exposure;
     };
 
     internal static class RayTracer
@@ -63,6 +125,80 @@ namespace Visualizer
         public static unsafe extern void DeleteScene3(void* scene);
 
         [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
-        public static unsafe extern float RenderImage3(void* scene, RenderConfiguration config, ARGB* buffer, ref float progress);
+        public static unsafe extern void* LoadScene3([MarshalAs(UnmanagedType.LPUTF8Str)] string path);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        public static unsafe extern bool SaveScene3(void* scene, [MarshalAs(UnmanagedType.LPUTF8Str)] string path);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        public static unsafe extern bool ImportMesh3(void* scene, [MarshalAs(UnmanagedType.LPUTF8Str)] string path);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static unsafe extern uint AddMeshAsset3(void* scene, [MarshalAs(UnmanagedType.LPUTF8Str)] string path);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        public static unsafe extern bool AddInstance3(void* scene, uint asset, float[] transform, uint materialOverride);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static unsafe extern float RebuildScene3(void* scene);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static unsafe extern float RefitScene3(void* scene);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static unsafe extern ulong GetMaterialCount3(void* scene);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        public static unsafe extern bool GetMaterial3(void* scene, uint index, out Material material);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        public static unsafe extern bool SetMaterial3(void* scene, uint index, Material material);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static unsafe extern float RenderImage3(void* scene, RenderConfiguration config, void* buffer, ref float progress);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static unsafe extern float RenderRows3(void* scene, RenderConfiguration config, ulong first_row, ulong row_count, void* buffer, ref float progress);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static unsafe extern IntPtr StartRender3(void* scene, RenderConfiguration config, void* buffer);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static extern RenderJobState PollRender3(IntPtr job, ref float progress);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void CancelRender3(IntPtr job);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static extern ulong GetCompletedTiles3(IntPtr job, [Out] ulong[] bitmap, ulong word_count);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void GetTileGrid3(IntPtr job, out int tile_size, out int columns, out int rows);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static extern float WaitRender3(IntPtr job);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static unsafe extern void* CreateAccumulationBuffer3();
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static unsafe extern void DeleteAccumulationBuffer3(void* accumulation);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static unsafe extern void ResetAccumulationBuffer3(void* accumulation);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static unsafe extern ulong GetAccumulatedSampleCount3(void* accumulation);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static unsafe extern float RenderProgressive3(void* scene, RenderConfiguration config, void* accumulation, ref float progress);
+
+        [DllImport("RayTracer.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static unsafe extern void ResolveAccumulationBuffer3(void* accumulation, void* buffer);
     }
 }